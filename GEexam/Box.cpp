@@ -2,12 +2,11 @@
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 
-Box::Box(const glm::vec3& position, const glm::vec3& size)
+Box::Box(const glm::vec3& position, const glm::vec3& size, uint64_t seed, uint64_t stream)
     : mPosition(position),
     mSize(size),
     mCollideSpheres(position, size), 
-    mParticleSystem(1000, position - size / 2.0f, position + size / 2.0f) {
-    makingBox(); 
+    mParticleSystem(1000, position - size / 2.0f, position + size / 2.0f, seed, stream) {
 }
 
 uint32_t Box::addSphereEntity(const glm::vec3& position, const glm::vec3& velocity, float radius, const glm::vec3& color) {
@@ -19,40 +18,43 @@ void Box::update(float deltaTime) {
     glm::vec3 boxMin = mPosition - mSize * 0.5f;
     glm::vec3 boxMax = mPosition + mSize * 0.5f;
 
+    // Spheres first, their grid is what the particles collide against
+    mCollideSpheres.update(deltaTime);
+
     // Update particles
     mParticleSystem.setBounds(boxMin, boxMax);
-    mParticleSystem.update(deltaTime);
+    mParticleSystem.update(deltaTime, &mCollideSpheres.getGrid());
 
-    
-    mCollideSpheres.update(deltaTime);
     //mCollideSpheres.printAllEntities();
 }
 
-void Box::render(Shader& shader, const glm::mat4& view, const glm::mat4& projection) {
-    shader.use();
-
-    // Render the box
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, mPosition);
-    model = glm::scale(model, glm::vec3(1.0f));
-
-    shader.setMat4("model", model);
-    shader.setMat4("view", view);
-    shader.setMat4("projection", projection);
+void Box::render(Shader& shader, RenderQueue& queue, RenderView& renderView) {
+    submitBox(shader, queue, renderView);
+    mParticleSystem.render(shader, queue, renderView);
+    mCollideSpheres.render(queue, renderView);
+}
 
-    // Lighting and material properties
-    shader.setVec3("lightPos", glm::vec3(0.0f, 20.0f, 0.0f));
-    shader.setVec3("viewPos", glm::vec3(0.0f, 5.0f, 10.0f));
-    shader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
-    shader.setVec3("objectColor", glm::vec3(1.0f, 0.0f, 0.0f));
-    shader.setBool("useFlatColor", false);
+void Box::render(Shader& shader, RenderQueue& queue, RenderView& renderView, const RenderFrame& frame) {
+    submitBox(shader, queue, renderView);
+    mParticleSystem.render(shader, queue, renderView, frame.particles);
+    mCollideSpheres.render(queue, renderView, frame.spheres);
+}
 
-    glBindVertexArray(mVAO);
-    glDrawElements(GL_TRIANGLES, 6 * 5, GL_UNSIGNED_INT, 0); 
-    glBindVertexArray(0);
+void Box::submitBox(Shader& shader, RenderQueue& queue, RenderView& renderView) {
+    if (mVAO == 0) makingBox();
 
-    mParticleSystem.render(shader, view, projection);
-    mCollideSpheres.render(shader, view, projection);
+    // Box geometry spans y = 0..size.y above its position
+    glm::vec3 boxCenter = mPosition + glm::vec3(0.0f, mSize.y * 0.5f, 0.0f);
+    if (renderView.frustum.testSphere(boxCenter, glm::length(mSize) * 0.5f)) {
+        DrawPacket packet;
+        packet.shader = &shader;
+        packet.vao = mVAO;
+        packet.indexed = true;
+        packet.count = 6 * 5; // 5 sides (floor + 4 walls)
+        packet.model = glm::translate(glm::mat4(1.0f), mPosition);
+        packet.color = glm::vec3(1.0f, 0.0f, 0.0f);
+        queue.submit(packet, renderView.viewDepth(boxCenter), renderView);
+    }
 }
 
 void Box::makingBox() {
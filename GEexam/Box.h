@@ -11,12 +11,59 @@
 
 class Box {
 public:
-    Box(const glm::vec3& position, const glm::vec3& size);
+    struct Snapshot {
+        CollideSpheres::Snapshot spheres;
+        ParticleSystem::Snapshot particles;
+    };
+
+    // Draw state of one update, see World::setThreaded
+    struct RenderFrame {
+        CollideSpheres::RenderFrame spheres;
+        ParticleSystem::RenderFrame particles;
+    };
+
+    // seed and stream feed the box's particle RNG, see ParticleSystem
+    Box(const glm::vec3& position, const glm::vec3& size, uint64_t seed = Random::DEFAULT_SEED,
+        uint64_t stream = ParticleSystem::AUTO_STREAM);
 
    
     uint32_t addSphereEntity(const glm::vec3& position, const glm::vec3& velocity, float radius, const glm::vec3& color);
     void update(float deltaTime);
-    void render(Shader& shader, const glm::mat4& view, const glm::mat4& projection);
+    void render(Shader& shader, RenderQueue& queue, RenderView& renderView);
+    void render(Shader& shader, RenderQueue& queue, RenderView& renderView, const RenderFrame& frame);
+
+    // Copies what render() draws into frame, for updates on a thread without the GL context
+    void publish(RenderFrame& frame) const {
+        mCollideSpheres.publish(frame.spheres);
+        mParticleSystem.publish(frame.particles);
+    }
+    void setDeferredUpload(bool deferred) { mParticleSystem.setDeferredUpload(deferred); }
+
+    void setParticleEffect(const ParticleEffect& effect) { mParticleSystem.setEffect(effect); }
+
+    void setPhysicsSettings(const PhysicsSettings& settings) { mCollideSpheres.setPhysicsSettings(settings); }
+    void applyForce(uint32_t entity, const glm::vec3& force) { mCollideSpheres.applyForce(entity, force); }
+    bool addJoint(uint32_t a, uint32_t b, float stiffness, float damping, float restLength = -1.0f) {
+        return mCollideSpheres.addJoint(a, b, stiffness, damping, restLength);
+    }
+
+    void hashState(StateHash& hash) const {
+        mCollideSpheres.hashState(hash);
+        mParticleSystem.hashState(hash);
+    }
+
+    void saveState(Snapshot& snapshot) const {
+        mCollideSpheres.saveState(snapshot.spheres);
+        mParticleSystem.saveState(snapshot.particles);
+    }
+    void restoreState(const Snapshot& snapshot) {
+        mCollideSpheres.restoreState(snapshot.spheres);
+        mParticleSystem.restoreState(snapshot.particles);
+    }
+
+    const CollideSpheres& getSpheres() const { return mCollideSpheres; }
+    ParticleSystem& getParticleSystem() { return mParticleSystem; }
+    const ParticleSystem& getParticleSystem() const { return mParticleSystem; }
 
 private:
     glm::vec3 mPosition; 
@@ -26,8 +73,10 @@ private:
     CollideSpheres mCollideSpheres; 
     ParticleSystem mParticleSystem; 
 
-    GLuint mVAO, mVBO, mEBO;
+    // Made by the first render, so a box can be built without a GL context
+    GLuint mVAO = 0, mVBO = 0, mEBO = 0;
     void makingBox(); 
+    void submitBox(Shader& shader, RenderQueue& queue, RenderView& renderView);
 };
 
 //class Box {
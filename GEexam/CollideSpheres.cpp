@@ -1,5 +1,7 @@
 #include "CollideSpheres.h"
 #include <functional>
+#include <cstring>
+#include <chrono>
 
 
 CollideSpheres::CollideSpheres(const glm::vec3& boxPosition, const glm::vec3& boxSize)
@@ -15,25 +17,40 @@ uint32_t CollideSpheres::addSphere(const glm::vec3& position, const glm::vec3& v
         mComponents.resize(entity + 1);
     }
 
-    size_t vertexCount;
-    uint32_t vao = createSphereVAO(radius, vertexCount);
-
     mComponents.transforms[entity] = { position, {}, glm::vec3(1.0f) };
+    mComponents.previousPositions[entity] = position;
     mComponents.physics[entity] = { velocity, 1.0f, radius };
 
+    // Drawn with the shared LOD meshes, no buffers of its own
     mComponents.renders[entity] = {
-        vao,        // VAO
-        0,          // VBO
-        0,          // EBO
-        color,      // Color
-        radius,     // Radius
-        vertexCount // Vertex Count
+        0,                          // VAO
+        0,                          // VBO
+        0,                          // EBO
+        color,                      // Color
+        radius,                     // Radius
+        0                           // Vertex Count
     };
+    mComponents.transformDirty[entity] = 1;
 
     mSphereEntities.push_back(entity);
     return entity;
 }
 
+bool CollideSpheres::addJoint(uint32_t a, uint32_t b, float stiffness, float damping, float restLength) {
+    const size_t count = mComponents.physics.size();
+    if (a >= count || b >= count || a == b) return false;
+
+    SpringJoint joint;
+    joint.a = a;
+    joint.b = b;
+    joint.restLength = restLength >= 0.0f ? restLength
+        : glm::length(mComponents.transforms[a].position - mComponents.transforms[b].position);
+    joint.stiffness = stiffness;
+    joint.damping = damping;
+    mComponents.joints.push_back(joint);
+    return true;
+}
+
 void CollideSpheres::printAllEntities() {
     std::cout << "Current Entities:" << std::endl;
     for (uint32_t entity : mSphereEntities) {
@@ -63,30 +80,206 @@ void CollideSpheres::printAllEntities() {
 
 
 void CollideSpheres::update(float deltaTime) {
-    // Update physics for all entities in this box
-    PhysicsSystem::update(mComponents, deltaTime);
+    mLastTimings = SphereUpdateTimings();
+    auto start = std::chrono::steady_clock::now();
+    auto millisecondsSince = [](std::chrono::steady_clock::time_point& start) {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - start).count();
+        start = now;
+        return ms;
+    };
+
+    // Keep the pre-step positions for render interpolation
+    TransformSystem::beginStep(mComponents);
+
+    if (mPhysicsSettings.mode == SimulationMode::EventDriven && mPhysicsSettings.gravity == glm::vec3(0.0f) &&
+        mPhysicsSettings.linearDrag == 0.0f && mComponents.joints.empty()) {
+        // Pending forces act as one impulse over the step
+        for (size_t i = 0; i < mComponents.physics.size(); ++i) {
+            PhysicsComponent& physics = mComponents.physics[i];
+            if (physics.mass > 0.0f) {
+                physics.velocity += mComponents.forces[i].force * (deltaTime / physics.mass);
+            }
+            mComponents.forces[i].force = glm::vec3(0.0f);
+        }
+
+        mEventSimulation.advance(mComponents, mWorldBounds, deltaTime, mPhysicsSettings.maxEventsPerUpdate);
+        mLastSubSteps = 1;
+        mLastTimings.eventMs = millisecondsSince(start);
+
+        // The particles still collide against the grid
+        mGrid.build(mComponents, mWorldBounds.min, mWorldBounds.max);
+        mLastTimings.gridMs = millisecondsSince(start);
+        return;
+    }
+
+    // Fast spheres get several shorter steps so none skips past a wall or another sphere
+    mLastSubSteps = PhysicsSystem::chooseSubSteps(mComponents, deltaTime, mPhysicsSettings, mPhysicsScratch);
+    const float subStep = deltaTime / mLastSubSteps;
+    mLastTimings.integrateMs = millisecondsSince(start);
+
+    for (int step = 0; step < mLastSubSteps; ++step) {
+        // Springs first, under either integrator: their implicit velocity change feeds the
+        // integration below
+        mJointSolver.solve(mComponents, subStep);
+        mLastTimings.jointMs += millisecondsSince(start);
+
+        // Update physics for all entities in this box
+        PhysicsSystem::update(mComponents, subStep, mPhysicsSettings, step == mLastSubSteps - 1);
+        mLastTimings.integrateMs += millisecondsSince(start);
+
+        // Sphere and wall contacts are solved together, pairs come from the grid
+        mGrid.build(mComponents, mWorldBounds.min, mWorldBounds.max);
+        mLastTimings.gridMs += millisecondsSince(start);
+        mContactSolver.solve(mComponents, mGrid, mWorldBounds, subStep, mPhysicsSettings.contacts);
+        mLastTimings.contactMs += millisecondsSince(start);
+    }
+}
+
+// Hashed as raw bytes, so the components must not contain padding
+static_assert(sizeof(TransformComponent) == 9 * sizeof(float), "TransformComponent has padding");
+static_assert(sizeof(PhysicsComponent) == 5 * sizeof(float), "PhysicsComponent has padding");
+static_assert(sizeof(ForceComponent) == 3 * sizeof(float), "ForceComponent has padding");
+static_assert(sizeof(SpringJoint) == 2 * sizeof(uint32_t) + 3 * sizeof(float), "SpringJoint has padding");
+
+void CollideSpheres::hashState(StateHash& hash) const {
+    const size_t count = mComponents.physics.size();
+    hash.add(static_cast<uint64_t>(count));
+    hash.addArray(mComponents.transforms, count);
+    hash.addArray(mComponents.physics, count);
+    hash.addArray(mComponents.forces, count);
+    hash.addArray(mComponents.previousPositions, count);
+    for (const RenderComponent& render : mComponents.renders) {
+        hash.add(&render.color, sizeof(render.color));
+        hash.add(&render.radius, sizeof(render.radius));
+    }
+
+    // Warm start impulses field by field, the struct is padded
+    const std::vector<ContactImpulse>& impulses = mContactSolver.getWarmStart();
+    hash.add(static_cast<uint64_t>(impulses.size()));
+    for (const ContactImpulse& impulse : impulses) {
+        hash.add(impulse.key);
+        hash.add(&impulse.impulse, sizeof(impulse.impulse));
+    }
+
+    hash.add(static_cast<uint64_t>(mComponents.joints.size()));
+    hash.addArray(mComponents.joints, mComponents.joints.size());
+    mEventSimulation.hashState(hash);
 
-    // Handle world bounds collisions
-    CollisionSystem::updateWorldBoundCollisions(mComponents, mWorldBounds);
+    hash.add(static_cast<uint64_t>(mSphereEntities.size()));
+    hash.addArray(mSphereEntities, mSphereEntities.size());
+    hash.add(static_cast<uint64_t>(mEntityManager.freeEntityIDs.size()));
+    hash.addArray(mEntityManager.freeEntityIDs, mEntityManager.freeEntityIDs.size());
+    hash.add(static_cast<uint64_t>(mEntityManager.entityCount));
+}
+
+void CollideSpheres::saveState(Snapshot& snapshot) const {
+    // assign() keeps the snapshot's capacity, so a reused ring slot doesn't allocate
+    snapshot.transforms.assign(mComponents.transforms.begin(), mComponents.transforms.end());
+    snapshot.physics.assign(mComponents.physics.begin(), mComponents.physics.end());
+    snapshot.forces.assign(mComponents.forces.begin(), mComponents.forces.end());
+    snapshot.renders.assign(mComponents.renders.begin(), mComponents.renders.end());
+    snapshot.previousPositions.assign(mComponents.previousPositions.begin(), mComponents.previousPositions.end());
+    snapshot.contactImpulses.assign(mContactSolver.getWarmStart().begin(), mContactSolver.getWarmStart().end());
+    snapshot.joints.assign(mComponents.joints.begin(), mComponents.joints.end());
+    mEventSimulation.saveState(snapshot.events, mComponents, mWorldBounds);
+    snapshot.sphereEntities.assign(mSphereEntities.begin(), mSphereEntities.end());
+    snapshot.freeEntityIDs.assign(mEntityManager.freeEntityIDs.begin(), mEntityManager.freeEntityIDs.end());
+    snapshot.entityCount = mEntityManager.entityCount;
+}
+
+void CollideSpheres::restoreState(const Snapshot& snapshot) {
+    const size_t count = snapshot.transforms.size();
+    // Entities created since the snapshot go, new slots come back dirty
+    mComponents.resize(count);
+
+    // The cached instance matrices are only valid for unchanged transforms, so those
+    // chunks are skipped and the rest copied and flagged for a rebuild
+    for (size_t begin = 0; begin < count; begin += SNAPSHOT_CHUNK) {
+        const size_t n = std::min(SNAPSHOT_CHUNK, count - begin);
+        bool changed = std::memcmp(&mComponents.transforms[begin], &snapshot.transforms[begin], n * sizeof(TransformComponent)) != 0 ||
+            std::memcmp(&mComponents.renders[begin], &snapshot.renders[begin], n * sizeof(RenderComponent)) != 0;
+        if (!changed) continue;
+
+        std::memcpy(&mComponents.transforms[begin], &snapshot.transforms[begin], n * sizeof(TransformComponent));
+        std::memcpy(&mComponents.renders[begin], &snapshot.renders[begin], n * sizeof(RenderComponent));
+        std::fill_n(mComponents.transformDirty.begin() + begin, n, uint8_t(1));
+    }
 
-    // Handle inter-entity collisions
-    CollisionSystem::updateInterEntityCollisions(mComponents);
+    if (count > 0) {
+        std::memcpy(mComponents.physics.data(), snapshot.physics.data(), count * sizeof(PhysicsComponent));
+        std::memcpy(mComponents.forces.data(), snapshot.forces.data(), count * sizeof(ForceComponent));
+        std::memcpy(mComponents.previousPositions.data(), snapshot.previousPositions.data(), count * sizeof(glm::vec3));
+    }
+    mContactSolver.setWarmStart(snapshot.contactImpulses);
+    mComponents.joints = snapshot.joints;
+    mEventSimulation.restoreState(snapshot.events, mComponents, mWorldBounds);
+    mSphereEntities = snapshot.sphereEntities;
+    mEntityManager.freeEntityIDs = snapshot.freeEntityIDs;
+    mEntityManager.entityCount = snapshot.entityCount;
+}
+
+void CollideSpheres::createMeshes() {
+    // Subdivision 3, 2, 1: 512, 128 and 32 triangles
+    for (int lod = 0; lod < RenderSystem::LOD_COUNT; ++lod) {
+        SphereMesh& mesh = mSphereLods[lod];
+        mesh.vao = createSphereVAO(1.0f, 3 - lod, mesh.vertexCount);
+        mRenderSystem.attachInstanceBuffer(mesh.vao);
+    }
 }
 
-void CollideSpheres::render(Shader& shader, const glm::mat4& view, const glm::mat4& projection) {
-    RenderSystem renderSystem;
-    renderSystem.render(mComponents, shader, view, projection);
+void CollideSpheres::render(RenderQueue& queue, RenderView& renderView) {
+    if (mComponents.renders.empty()) return;
+    if (mSphereLods[0].vao == 0) createMeshes();
+    mRenderSystem.render(queue, mComponents, mSphereLods, renderView);
+}
+
+void CollideSpheres::publish(RenderFrame& frame) const {
+    frame.transforms.assign(mComponents.transforms.begin(), mComponents.transforms.end());
+    frame.previousPositions.assign(mComponents.previousPositions.begin(), mComponents.previousPositions.end());
+    frame.renders.assign(mComponents.renders.begin(), mComponents.renders.end());
+}
+
+void CollideSpheres::render(RenderQueue& queue, RenderView& renderView, const RenderFrame& frame) {
+    const size_t count = frame.transforms.size();
+    if (count == 0) return;
+    if (mSphereLods[0].vao == 0) createMeshes();
+
+    // Bring the render copy up to the frame, flagging what moved. Its own LODs stay, the
+    // simulation's copy never has them picked.
+    ComponentArrays& target = mRenderComponents;
+    if (target.transforms.size() != count) {
+        target.resize(count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const TransformComponent& transform = frame.transforms[i];
+        const RenderComponent& render = frame.renders[i];
+        if (std::memcmp(&target.transforms[i], &transform, sizeof(TransformComponent)) != 0 ||
+            target.previousPositions[i] != frame.previousPositions[i] ||
+            target.renders[i].radius != render.radius || target.renders[i].color != render.color) {
+            uint8_t lod = target.renders[i].lod;
+            target.transforms[i] = transform;
+            target.previousPositions[i] = frame.previousPositions[i];
+            target.renders[i] = render;
+            target.renders[i].lod = lod;
+            target.transformDirty[i] = 1;
+        }
+    }
+    mRenderSystem.render(queue, target, mSphereLods, renderView);
 }
 
 void CollideSpheres::removeEntity(uint32_t entity) {
     mEntityManager.destroyEntity(entity);
+    auto& joints = mComponents.joints;
+    joints.erase(std::remove_if(joints.begin(), joints.end(),
+        [entity](const SpringJoint& joint) { return joint.a == entity || joint.b == entity; }), joints.end());
     auto it = std::find(mSphereEntities.begin(), mSphereEntities.end(), entity);
     if (it != mSphereEntities.end()) {
         mSphereEntities.erase(it);
     }
 }
 
-uint32_t CollideSpheres::createSphereVAO(float radius, size_t& outVertexCount)
+uint32_t CollideSpheres::createSphereVAO(float radius, int subdivisions, size_t& outVertexCount)
 {
     std::vector<glm::vec3> vertices;
 
@@ -117,14 +310,14 @@ uint32_t CollideSpheres::createSphereVAO(float radius, size_t& outVertexCount)
         };
 
     // Perform subdivisions
-    subDivide(v0, v1, v2, 3);
-    subDivide(v0, v2, v3, 3);
-    subDivide(v0, v3, v4, 3);
-    subDivide(v0, v4, v1, 3);
-    subDivide(v5, v2, v1, 3);
-    subDivide(v5, v3, v2, 3);
-    subDivide(v5, v4, v3, 3);
-    subDivide(v5, v1, v4, 3);
+    subDivide(v0, v1, v2, subdivisions);
+    subDivide(v0, v2, v3, subdivisions);
+    subDivide(v0, v3, v4, subdivisions);
+    subDivide(v0, v4, v1, subdivisions);
+    subDivide(v5, v2, v1, subdivisions);
+    subDivide(v5, v3, v2, subdivisions);
+    subDivide(v5, v4, v3, subdivisions);
+    subDivide(v5, v1, v4, subdivisions);
 
     // Prepare data for VAO
     std::vector<float> interleavedVertices;
@@ -30,19 +30,102 @@
 #include "Shader.h"
 #include "EntityManager.h"
 #include "SystemManager.h"
+#include "RenderView.h"
+#include "StateHash.h"
+#include "JointSolver.h"
+#include "EventSimulation.h"
 #include <glm/glm.hpp>
 
+// CPU time per phase of one update(), summed over its sub-steps
+struct SphereUpdateTimings {
+    double jointMs = 0.0;
+    double integrateMs = 0.0;
+    double gridMs = 0.0;
+    double contactMs = 0.0;
+    double eventMs = 0.0;       // SimulationMode::EventDriven, instead of the four above
+};
+
 class CollideSpheres {
 public:
+    // Copy of everything update() reads and writes, see saveState
+    struct Snapshot {
+        std::vector<TransformComponent> transforms;
+        std::vector<PhysicsComponent> physics;
+        std::vector<ForceComponent> forces;
+        std::vector<RenderComponent> renders;
+        std::vector<glm::vec3> previousPositions;
+        std::vector<ContactImpulse> contactImpulses;
+        EventSimulation::Snapshot events;
+        std::vector<SpringJoint> joints;
+        std::vector<uint32_t> sphereEntities;
+        std::vector<uint32_t> freeEntityIDs;
+        uint32_t entityCount = 0;
+    };
+
+    // Sphere state render() reads, copied out by publish() for drawing on another thread
+    struct RenderFrame {
+        std::vector<TransformComponent> transforms;
+        std::vector<glm::vec3> previousPositions;
+        std::vector<RenderComponent> renders;
+    };
+
+    // Entities per chunk compared on restore; only chunks that differ are copied back
+    // and have their instance matrices rebuilt
+    static constexpr size_t SNAPSHOT_CHUNK = 64;
+
     CollideSpheres(const glm::vec3& boxPosition, const glm::vec3& boxSize);
 
     uint32_t addSphere(const glm::vec3& position, const glm::vec3& velocity, float radius, const glm::vec3& color);
 
     void printAllEntities();
     void update(float deltaTime);
-    void render(Shader& shader, const glm::mat4& view, const glm::mat4& projection);
+    void render(RenderQueue& queue, RenderView& renderView);
+
+    // Draws a published frame from a render-side copy of the components, which keeps
+    // the LODs and instance matrices between frames
+    void render(RenderQueue& queue, RenderView& renderView, const RenderFrame& frame);
+    void publish(RenderFrame& frame) const;
+
     void removeEntity(uint32_t entity);
-    uint32_t createSphereVAO(float radius, size_t& outVertexCount);
+    uint32_t createSphereVAO(float radius, int subdivisions, size_t& outVertexCount);
+
+    void setPhysicsSettings(const PhysicsSettings& settings) { mPhysicsSettings = settings; }
+
+    // Added to the entity's force for the next update() only
+    void applyForce(uint32_t entity, const glm::vec3& force) { PhysicsSystem::applyForce(mComponents, entity, force); }
+
+    // Joins two spheres with a damped spring, solved implicitly each step so stiff springs
+    // stay stable under either integrator. restLength < 0 keeps their current distance.
+    // Returns false for an unknown entity or a sphere joined to itself.
+    bool addJoint(uint32_t a, uint32_t b, float stiffness, float damping, float restLength = -1.0f);
+    void clearJoints() { mComponents.joints.clear(); }
+    const JointStats& getJointStats() const { return mJointSolver.getStats(); }
+
+    // Adds everything saveState() keeps to hash: components, warm start, joints, the
+    // event simulation and the entity ids
+    void hashState(StateHash& hash) const;
+
+    // Copies the sphere state into snapshot, reusing its storage once it has grown
+    void saveState(Snapshot& snapshot) const;
+    void restoreState(const Snapshot& snapshot);
+
+    // Sub-steps the last update() ran, see PhysicsSettings::maxTravel
+    int getLastSubSteps() const { return mLastSubSteps; }
+
+    // Contacts and solver passes of the last sub-step
+    const ContactStats& getContactStats() const { return mContactSolver.getStats(); }
+
+    const SphereUpdateTimings& getLastTimings() const { return mLastTimings; }
+    size_t getSphereCount() const { return mSphereEntities.size(); }
+
+    // Events of the last update in SimulationMode::EventDriven
+    const EventStats& getEventStats() const { return mEventSimulation.getStats(); }
+
+    // Broadphase grid over the spheres, rebuilt by update() and shared with the particles
+    const SpatialGrid& getGrid() const { return mGrid; }
+
+    // Read-only view of the sphere components, indexed by entity
+    const ComponentArrays& getComponents() const { return mComponents; }
 
 
     std::vector<uint32_t> mSphereEntities;
@@ -54,6 +137,23 @@ private:
     ComponentArrays mComponents;       // Stores components for entities in this box
 
     WorldBoundsComponent mWorldBounds; 
+    PhysicsSettings mPhysicsSettings;
+    int mLastSubSteps = 1;
+    SphereUpdateTimings mLastTimings;
+    SpatialGrid mGrid;
+    ContactSolver mContactSolver;
+    JointSolver mJointSolver;
+    PhysicsSystem::Scratch mPhysicsScratch;
+    EventSimulation mEventSimulation;
+
+    // Unit sphere mesh levels shared by every entity, scaled per instance. Created by the
+    // first render, so adding spheres makes no GL calls.
+    SphereMesh mSphereLods[RenderSystem::LOD_COUNT];
+    RenderSystem mRenderSystem;
+    void createMeshes();
+
+    // GL thread's copy for rendering published frames
+    ComponentArrays mRenderComponents;
 
      
 };
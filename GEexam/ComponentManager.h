@@ -16,6 +16,20 @@ struct PhysicsComponent {
     float radius = 1.0f;
 };
 
+// Forces added during a step, applied and cleared by PhysicsSystem
+struct ForceComponent {
+    glm::vec3 force{ 0.0f };
+};
+
+// Damped spring between two entities, solved implicitly by JointSolver
+struct SpringJoint {
+    uint32_t a = 0;
+    uint32_t b = 0;
+    float restLength = 1.0f;
+    float stiffness = 100.0f;   // Force per unit of stretch
+    float damping = 1.0f;       // Force per unit of relative speed along the spring
+};
+
 struct RenderComponent {
     uint32_t vao = 0;
     uint32_t vbo = 0;
@@ -23,6 +37,14 @@ struct RenderComponent {
     glm::vec3 color{ 1.0f, 0.0f, 0.0f }; 
     float radius = 1.0f;
     size_t vertexCount = 0;
+    uint8_t lod = 0;    // Current sphere mesh level, picked by RenderSystem
+};
+
+// Per-instance vertex attributes for instanced drawing (locations 2-9 in Exam.vs)
+struct InstanceData {
+    glm::mat4 model{ 1.0f };
+    glm::mat3 normal{ 1.0f };
+    glm::vec3 color{ 1.0f };
 };
 
 struct WorldBoundsComponent {
@@ -35,8 +57,19 @@ struct ComponentArrays {
     // Aligned storage for components
     std::vector<TransformComponent> transforms;
     std::vector<PhysicsComponent> physics;
+    std::vector<ForceComponent> forces;
     std::vector<RenderComponent> renders;
 
+    // Springs between entities, not indexed by entity
+    std::vector<SpringJoint> joints;
+
+    // Positions at the start of the last fixed step; rendering blends from these to transforms
+    std::vector<glm::vec3> previousPositions;
+
+    // Cached model/normal matrices, only rebuilt for entities flagged dirty
+    std::vector<InstanceData> instances;
+    std::vector<uint8_t> transformDirty;
+
     // Mapping between entity IDs and component indices
     std::vector<uint32_t> entityToTransformIndex;
     std::vector<uint32_t> entityToPhysicsIndex;
@@ -45,7 +78,11 @@ struct ComponentArrays {
     void resize(size_t newSize) {
         transforms.resize(newSize);
         physics.resize(newSize);
+        forces.resize(newSize);
         renders.resize(newSize);
+        previousPositions.resize(newSize);
+        instances.resize(newSize);
+        transformDirty.resize(newSize, 1);
         entityToTransformIndex.resize(newSize);
         entityToPhysicsIndex.resize(newSize);
         entityToRenderIndex.resize(newSize);
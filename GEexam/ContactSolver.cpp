@@ -0,0 +1,194 @@
+#include "ContactSolver.h"
+#include <algorithm>
+#include <cmath>
+
+void ContactSolver::addContact(uint32_t a, uint32_t b, uint64_t key, const glm::vec3& normal, float depth) {
+    float inverseMass = mInverseMass[a] + mInverseMass[b];
+    if (inverseMass <= 0.0f) return;
+
+    mA.push_back(a);
+    mB.push_back(b);
+    mKey.push_back(key);
+    mNx.push_back(normal.x);
+    mNy.push_back(normal.y);
+    mNz.push_back(normal.z);
+    mDepth.push_back(depth);
+    mMass.push_back(1.0f / inverseMass);
+}
+
+void ContactSolver::findContacts(const ComponentArrays& components, const SpatialGrid& grid, const WorldBoundsComponent& bounds) {
+    mA.clear();
+    mB.clear();
+    mKey.clear();
+    mNx.clear();
+    mNy.clear();
+    mNz.clear();
+    mDepth.clear();
+    mMass.clear();
+
+    grid.forEachPair([&](uint32_t a, uint32_t b) {
+        glm::vec3 delta = components.transforms[a].position - components.transforms[b].position;
+        float radii = components.physics[a].radius + components.physics[b].radius;
+        float distanceSq = glm::dot(delta, delta);
+        if (distanceSq >= radii * radii) return;
+
+        // Coincident centres have no direction, push them apart vertically
+        float distance = std::sqrt(distanceSq);
+        glm::vec3 normal = distance > 1e-6f ? delta / distance : glm::vec3(0.0f, 1.0f, 0.0f);
+        uint64_t key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+        addContact(a, b, key, normal, radii - distance);
+    });
+
+    // Wall keys use the face as the second half, above any entity id
+    const uint32_t wall = static_cast<uint32_t>(components.physics.size());
+    for (uint32_t i = 0; i < wall; ++i) {
+        const glm::vec3& position = components.transforms[i].position;
+        float radius = components.physics[i].radius;
+        for (int axis = 0; axis < 3; ++axis) {
+            glm::vec3 normal(0.0f);
+            float low = bounds.min[axis] - (position[axis] - radius);
+            float high = (position[axis] + radius) - bounds.max[axis];
+            if (low > 0.0f) {
+                normal[axis] = 1.0f;
+                addContact(i, wall, (uint64_t(i) << 32) | (0xFFFFFFF0u + axis * 2), normal, low);
+            }
+            else if (high > 0.0f) {
+                normal[axis] = -1.0f;
+                addContact(i, wall, (uint64_t(i) << 32) | (0xFFFFFFF0u + axis * 2 + 1), normal, high);
+            }
+        }
+    }
+}
+
+void ContactSolver::warmStart() {
+    for (size_t c = 0; c < mA.size(); ++c) {
+        ContactImpulse probe{ mKey[c], 0.0f };
+        auto it = std::lower_bound(mCache.begin(), mCache.end(), probe);
+        if (it == mCache.end() || it->key != mKey[c]) continue;
+
+        const float impulse = it->impulse * WARM_START;
+        const uint32_t a = mA[c];
+        const uint32_t b = mB[c];
+        const float ia = impulse * mInverseMass[a];
+        const float ib = impulse * mInverseMass[b];
+        mVx[a] += ia * mNx[c];
+        mVy[a] += ia * mNy[c];
+        mVz[a] += ia * mNz[c];
+        mVx[b] -= ib * mNx[c];
+        mVy[b] -= ib * mNy[c];
+        mVz[b] -= ib * mNz[c];
+        mImpulse[c] = impulse;
+    }
+}
+
+float ContactSolver::solvePass(std::vector<float>& vx, std::vector<float>& vy, std::vector<float>& vz,
+    const std::vector<float>& target, std::vector<float>& impulse) {
+    float maxChange = 0.0f;
+    for (size_t c = 0; c < mA.size(); ++c) {
+        const uint32_t a = mA[c];
+        const uint32_t b = mB[c];
+        const float nx = mNx[c], ny = mNy[c], nz = mNz[c];
+        float normalSpeed = (vx[a] - vx[b]) * nx + (vy[a] - vy[b]) * ny + (vz[a] - vz[b]) * nz;
+
+        // Accumulated impulse may only push, so clamp the total rather than the step
+        float lambda = mMass[c] * (target[c] - normalSpeed);
+        float total = std::max(impulse[c] + lambda, 0.0f);
+        lambda = total - impulse[c];
+        impulse[c] = total;
+        if (lambda == 0.0f) continue;
+
+        const float ia = lambda * mInverseMass[a];
+        const float ib = lambda * mInverseMass[b];
+        vx[a] += ia * nx;
+        vy[a] += ia * ny;
+        vz[a] += ia * nz;
+        vx[b] -= ib * nx;
+        vy[b] -= ib * ny;
+        vz[b] -= ib * nz;
+        maxChange = std::max(maxChange, std::abs(ia) + std::abs(ib));
+    }
+    return maxChange;
+}
+
+void ContactSolver::solve(ComponentArrays& components, const SpatialGrid& grid, const WorldBoundsComponent& bounds,
+    float deltaTime, const ContactSettings& settings) {
+    const size_t count = components.physics.size();
+    mStats = ContactStats();
+    if (count == 0 || deltaTime <= 0.0f) return;
+
+    // Gather into SoA, slot count is the immovable wall
+    mInverseMass.resize(count + 1);
+    mVx.resize(count + 1);
+    mVy.resize(count + 1);
+    mVz.resize(count + 1);
+    for (size_t i = 0; i < count; ++i) {
+        const PhysicsComponent& physics = components.physics[i];
+        mInverseMass[i] = physics.mass > 0.0f ? 1.0f / physics.mass : 0.0f;
+        mVx[i] = physics.velocity.x;
+        mVy[i] = physics.velocity.y;
+        mVz[i] = physics.velocity.z;
+    }
+    mInverseMass[count] = 0.0f;
+    mVx[count] = mVy[count] = mVz[count] = 0.0f;
+
+    findContacts(components, grid, bounds);
+    const size_t contactCount = mA.size();
+    mStats.contacts = contactCount;
+    if (contactCount == 0) {
+        mCache.clear();
+        return;
+    }
+
+    // Targets from the approach speeds before any impulse
+    const float correction = settings.positionCorrection / deltaTime;
+    mVelocityTarget.resize(contactCount);
+    mPositionTarget.resize(contactCount);
+    mImpulse.assign(contactCount, 0.0f);
+    mPositionImpulse.assign(contactCount, 0.0f);
+    for (size_t c = 0; c < contactCount; ++c) {
+        const uint32_t a = mA[c];
+        const uint32_t b = mB[c];
+        float normalSpeed = (mVx[a] - mVx[b]) * mNx[c] + (mVy[a] - mVy[b]) * mNy[c] + (mVz[a] - mVz[b]) * mNz[c];
+        mVelocityTarget[c] = normalSpeed < -settings.restitutionThreshold ? -settings.restitution * normalSpeed : 0.0f;
+        mPositionTarget[c] = correction * std::max(mDepth[c] - settings.penetrationSlop, 0.0f);
+    }
+
+    // Restitution targets are set above from the unwarmed speeds, the warm impulse only
+    // gives the passes a head start
+    warmStart();
+
+    const int iterations = std::max(settings.iterations, 1);
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        ++mStats.velocityIterations;
+        if (solvePass(mVx, mVy, mVz, mVelocityTarget, mImpulse) < TOLERANCE) break;
+    }
+
+    mCache.resize(contactCount);
+    for (size_t c = 0; c < contactCount; ++c) {
+        mCache[c] = { mKey[c], mImpulse[c] };
+    }
+    std::sort(mCache.begin(), mCache.end());
+
+    mPx.assign(count + 1, 0.0f);
+    mPy.assign(count + 1, 0.0f);
+    mPz.assign(count + 1, 0.0f);
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        ++mStats.positionIterations;
+        if (solvePass(mPx, mPy, mPz, mPositionTarget, mPositionImpulse) < TOLERANCE) break;
+    }
+
+    // Scatter back. The bounds clamp catches what the soft correction leaves outside.
+    for (size_t i = 0; i < count; ++i) {
+        TransformComponent& transform = components.transforms[i];
+        PhysicsComponent& physics = components.physics[i];
+        physics.velocity = glm::vec3(mVx[i], mVy[i], mVz[i]);
+
+        glm::vec3 position = transform.position + glm::vec3(mPx[i], mPy[i], mPz[i]) * deltaTime;
+        glm::vec3 inset(physics.radius);
+        position = glm::clamp(position, glm::min(bounds.min + inset, bounds.max - inset), glm::max(bounds.min + inset, bounds.max - inset));
+        if (position != transform.position) {
+            transform.position = position;
+            components.transformDirty[i] = 1;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "ComponentManager.h"
+#include "SpatialGrid.h"
+
+// Contact solver settings, part of PhysicsSettings
+struct ContactSettings {
+    int iterations = 8;                 // Velocity and position passes per sub-step, at most
+    float restitution = 1.0f;           // 1 keeps collisions elastic
+    float restitutionThreshold = 0.25f; // Slower approach speeds don't bounce, so resting contacts settle
+    float positionCorrection = 0.4f;    // Fraction of the penetration pushed out per sub-step
+    float penetrationSlop = 0.005f;     // Penetration left alone, keeps resting contacts touching
+};
+
+// Accumulated impulse a contact ended a solve with, kept for warm starting
+struct ContactImpulse {
+    uint64_t key;               // Entity pair, or entity and wall face
+    float impulse;
+    bool operator<(const ContactImpulse& other) const { return key < other.key; }
+};
+
+// Contacts and passes of the last solve
+struct ContactStats {
+    size_t contacts = 0;
+    int velocityIterations = 0;
+    int positionIterations = 0;
+};
+
+// Sequential impulse (projected Gauss-Seidel) solver for sphere-sphere and sphere-wall
+// contacts. All contacts of a step are solved together, with accumulated impulses clamped
+// to push only, so stacks and piles come to rest instead of re-colliding every frame.
+// Penetration is removed with split impulses: a separate pseudo velocity moves the
+// positions without adding energy to the real velocities. Each contact starts from the
+// impulse it ended the previous solve with (warm starting), so a resting pile needs only
+// a few passes per step.
+class ContactSolver {
+public:
+    // Share of last solve's impulse a persisting contact starts with
+    static constexpr float WARM_START = 1.0f;
+
+    // Stops iterating once no contact changes a velocity by more than this
+    static constexpr float TOLERANCE = 1e-4f;
+
+    // Finds the overlapping pairs in grid and the spheres touching the bounds, then solves
+    // velocities and positions over deltaTime
+    void solve(ComponentArrays& components, const SpatialGrid& grid, const WorldBoundsComponent& bounds,
+        float deltaTime, const ContactSettings& settings);
+
+    const ContactStats& getStats() const { return mStats; }
+
+    // Warm start impulses, part of the simulation state for snapshots and rollback
+    const std::vector<ContactImpulse>& getWarmStart() const { return mCache; }
+    void setWarmStart(const std::vector<ContactImpulse>& impulses) { mCache = impulses; }
+
+private:
+    void findContacts(const ComponentArrays& components, const SpatialGrid& grid, const WorldBoundsComponent& bounds);
+    void addContact(uint32_t a, uint32_t b, uint64_t key, const glm::vec3& normal, float depth);
+
+    // Applies the matching impulses of the last solve to the new contacts
+    void warmStart();
+
+    // One pass over the contacts with impulse, driving (v[a] - v[b]).n towards target.
+    // Returns the largest velocity change.
+    float solvePass(std::vector<float>& vx, std::vector<float>& vy, std::vector<float>& vz,
+        const std::vector<float>& target, std::vector<float>& impulse);
+
+    ContactStats mStats;
+
+    // Per entity, with one static body after the last entity for the walls
+    std::vector<float> mInverseMass;
+    std::vector<float> mVx, mVy, mVz;           // Velocities
+    std::vector<float> mPx, mPy, mPz;           // Pseudo velocities of the position pass
+
+    // Contacts, SoA. The normal points from b to a.
+    std::vector<uint32_t> mA, mB;
+    std::vector<uint64_t> mKey;                 // Entity pair, or entity and wall face
+    std::vector<float> mNx, mNy, mNz;
+    std::vector<float> mDepth;
+    std::vector<float> mMass;                   // 1 / (inverse mass a + inverse mass b)
+    std::vector<float> mVelocityTarget;         // Separating speed after restitution
+    std::vector<float> mPositionTarget;         // Pseudo speed that removes the penetration
+    std::vector<float> mImpulse, mPositionImpulse;
+
+    // Last solve's impulses sorted by key, for warm starting
+    std::vector<ContactImpulse> mCache;
+};
@@ -1,5 +1,8 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
 #include <unordered_set>
 
 struct EntityManager {
@@ -0,0 +1,327 @@
+#include "EventSimulation.h"
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstring>
+
+void EventSimulation::push(const Event& event) {
+    mQueue.push_back(event);
+    std::push_heap(mQueue.begin(), mQueue.end(), std::greater<Event>());
+}
+
+glm::dvec3 EventSimulation::positionAt(uint32_t i, double time) const {
+    return mPosition[i] + mVelocity[i] * (time - mLocalTime[i]);
+}
+
+void EventSimulation::moveTo(uint32_t i, double time) {
+    mPosition[i] = positionAt(i, time);
+    mLocalTime[i] = time;
+}
+
+void EventSimulation::link(uint32_t i) {
+    int cell = cellIndex(mCell[i]);
+    mPrev[i] = -1;
+    mNext[i] = mCellHead[cell];
+    if (mNext[i] >= 0) mPrev[mNext[i]] = static_cast<int>(i);
+    mCellHead[cell] = static_cast<int>(i);
+}
+
+void EventSimulation::unlink(uint32_t i) {
+    if (mPrev[i] >= 0) mNext[mPrev[i]] = mNext[i];
+    else mCellHead[cellIndex(mCell[i])] = mNext[i];
+    if (mNext[i] >= 0) mPrev[mNext[i]] = mPrev[i];
+}
+
+bool EventSimulation::inSync(const ComponentArrays& components, const WorldBoundsComponent& bounds) const {
+    const size_t count = components.physics.size();
+    if (count != mWrittenPhysics.size()) return false;
+    if (bounds.min != mWrittenBounds.min || bounds.max != mWrittenBounds.max) return false;
+    for (size_t i = 0; i < count; ++i) {
+        if (components.transforms[i].position != mWrittenPositions[i]) return false;
+    }
+    return count == 0 || std::memcmp(components.physics.data(), mWrittenPhysics.data(), count * sizeof(PhysicsComponent)) == 0;
+}
+
+void EventSimulation::reschedule(const ComponentArrays& components, const WorldBoundsComponent& bounds) {
+    const size_t count = components.physics.size();
+    mTime = 0.0;
+    mPosition.resize(count);
+    mVelocity.resize(count);
+    mLocalTime.assign(count, 0.0);
+    mCount.assign(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+        mPosition[i] = glm::dvec3(components.transforms[i].position);
+        mVelocity[i] = glm::dvec3(components.physics[i].velocity);
+    }
+
+    rebuild(components, bounds, nullptr);
+    mStats.rescheduled = true;
+}
+
+void EventSimulation::rebuild(const ComponentArrays& components, const WorldBoundsComponent& bounds,
+    const std::vector<glm::ivec3>* cells) {
+    const size_t count = mPosition.size();
+    mRadius.resize(count);
+    mInverseMass.resize(count);
+
+    double maxRadius = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        const PhysicsComponent& physics = components.physics[i];
+        mRadius[i] = physics.radius;
+        mInverseMass[i] = physics.mass > 0.0f ? 1.0 / physics.mass : 0.0;
+        maxRadius = std::max(maxRadius, mRadius[i]);
+    }
+
+    // Cells at least one diameter wide, so colliding spheres are always in neighbouring
+    // cells, and around SPHERES_PER_CELL spheres each: crossings dominate the events when
+    // cells are much smaller, neighbour predictions when much larger
+    mBoundsMin = glm::dvec3(bounds.min);
+    mBoundsMax = glm::dvec3(bounds.max);
+    glm::dvec3 extent = glm::max(mBoundsMax - mBoundsMin, glm::dvec3(1e-3));
+    double volumePerCell = extent.x * extent.y * extent.z * SPHERES_PER_CELL / std::max<size_t>(count, 1);
+    double minCell = std::max({ 2.0 * maxRadius, std::cbrt(volumePerCell), 1e-3 });
+    for (int axis = 0; axis < 3; ++axis) {
+        mDims[axis] = std::min(std::max(static_cast<int>(extent[axis] / minCell), 1), MAX_CELLS_PER_AXIS);
+        mCellSize[axis] = extent[axis] / mDims[axis];
+    }
+
+    mCellHead.assign(mDims.x * mDims.y * mDims.z, -1);
+    mCell.resize(count);
+    mNext.resize(count);
+    mPrev.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::ivec3 cell = cells ? (*cells)[i] : glm::ivec3(glm::floor((mPosition[i] - mBoundsMin) / mCellSize));
+        mCell[i] = glm::clamp(cell, glm::ivec3(0), mDims - 1);
+        link(i);
+    }
+
+    compact();
+}
+
+void EventSimulation::compact() {
+    mQueue.clear();
+    for (uint32_t i = 0; i < mPosition.size(); ++i) {
+        predict(i, true);
+    }
+}
+
+void EventSimulation::predictPair(uint32_t i, uint32_t j) {
+    // Two massless spheres pass through each other
+    if (mInverseMass[i] + mInverseMass[j] <= 0.0) return;
+
+    // From the later of the two clocks
+    const double start = std::max(mLocalTime[i], mLocalTime[j]);
+    glm::dvec3 dp = positionAt(i, start) - positionAt(j, start);
+    glm::dvec3 dv = mVelocity[i] - mVelocity[j];
+
+    // |dp + dv t| = r solved for the first root, only while approaching
+    double b = glm::dot(dp, dv);
+    if (b >= 0.0) return;
+    double radii = mRadius[i] + mRadius[j];
+    double c = glm::dot(dp, dp) - radii * radii;
+    double discriminant = b * b - glm::dot(dv, dv) * c;
+    if (discriminant < 0.0) return;
+
+    // c / (-b + sqrt) is the smaller root without cancellation; overlapping pairs collide now
+    double t = c <= 0.0 ? 0.0 : c / (-b + std::sqrt(discriminant));
+    push({ std::max(start + t, mTime), i, j, mCount[i], mCount[j], EventType::Pair });
+}
+
+void EventSimulation::predict(uint32_t i, bool onlyAbove) {
+    const glm::dvec3& position = mPosition[i];
+    const glm::dvec3& velocity = mVelocity[i];
+    const double start = mLocalTime[i];
+
+    // Next wall and next cell boundary
+    double wallTime = INFINITY, cellTime = INFINITY;
+    uint32_t wallAxis = 0, cellAxis = 0;
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        double v = velocity[axis];
+        if (v == 0.0) continue;
+
+        double wall = v > 0.0 ? mBoundsMax[axis] - mRadius[i] : mBoundsMin[axis] + mRadius[i];
+        double t = std::max((wall - position[axis]) / v, 0.0);
+        if (t < wallTime) {
+            wallTime = t;
+            wallAxis = axis;
+        }
+
+        int cell = mCell[i][axis];
+        if (v > 0.0 ? cell + 1 < mDims[axis] : cell > 0) {
+            double boundary = mBoundsMin[axis] + (v > 0.0 ? cell + 1 : cell) * mCellSize[axis];
+            t = std::max((boundary - position[axis]) / v, 0.0);
+            if (t < cellTime) {
+                cellTime = t;
+                cellAxis = axis;
+            }
+        }
+    }
+    if (wallTime < INFINITY) push({ std::max(start + wallTime, mTime), i, wallAxis, mCount[i], 0, EventType::Wall });
+    if (cellTime < INFINITY) push({ std::max(start + cellTime, mTime), i, cellAxis, mCount[i], 0, EventType::Cell });
+
+    const glm::ivec3 lo = glm::max(mCell[i] - 1, glm::ivec3(0));
+    const glm::ivec3 hi = glm::min(mCell[i] + 1, mDims - 1);
+    for (int z = lo.z; z <= hi.z; ++z) {
+        for (int y = lo.y; y <= hi.y; ++y) {
+            for (int x = lo.x; x <= hi.x; ++x) {
+                for (int j = mCellHead[cellIndex(glm::ivec3(x, y, z))]; j >= 0; j = mNext[j]) {
+                    if (static_cast<uint32_t>(j) == i || (onlyAbove && static_cast<uint32_t>(j) < i)) continue;
+                    predictPair(i, static_cast<uint32_t>(j));
+                }
+            }
+        }
+    }
+}
+
+void EventSimulation::collidePair(uint32_t i, uint32_t j) {
+    moveTo(i, mTime);
+    moveTo(j, mTime);
+
+    glm::dvec3 delta = mPosition[i] - mPosition[j];
+    double distance = glm::length(delta);
+    double inverseMass = mInverseMass[i] + mInverseMass[j];
+    if (distance > 0.0 && inverseMass > 0.0) {
+        // Elastic: reverse the approach speed along the normal
+        glm::dvec3 normal = delta / distance;
+        double impulse = -2.0 * glm::dot(mVelocity[i] - mVelocity[j], normal) / inverseMass;
+        mVelocity[i] += normal * (impulse * mInverseMass[i]);
+        mVelocity[j] -= normal * (impulse * mInverseMass[j]);
+    }
+
+    ++mCount[i];
+    ++mCount[j];
+    predict(i);
+    predict(j);
+}
+
+void EventSimulation::collideWall(uint32_t i, uint32_t axis) {
+    moveTo(i, mTime);
+    mVelocity[i][axis] = -mVelocity[i][axis];
+    ++mCount[i];
+    predict(i);
+}
+
+void EventSimulation::crossCell(uint32_t i, uint32_t axis) {
+    // Only the cell changes; the sphere keeps its clock so its predictions stay the same
+    unlink(i);
+    int step = mVelocity[i][axis] > 0.0 ? 1 : -1;
+    mCell[i][axis] = std::min(std::max(mCell[i][axis] + step, 0), mDims[axis] - 1);
+    link(i);
+
+    // Predicting again also covers the spheres of the newly adjacent cells. Events it
+    // repeats are harmless: whichever copy runs first makes the other stale.
+    predict(i);
+}
+
+void EventSimulation::advance(ComponentArrays& components, const WorldBoundsComponent& bounds, float deltaTime,
+    size_t maxEvents) {
+    mStats = EventStats();
+    if (!inSync(components, bounds)) {
+        reschedule(components, bounds);
+    }
+    const size_t count = mPosition.size();
+
+    const double target = mTime + deltaTime;
+    while (!mQueue.empty() && mQueue.front().time <= target) {
+        if (mStats.events >= maxEvents) {
+            mStats.truncated = true;
+            break;
+        }
+        std::pop_heap(mQueue.begin(), mQueue.end(), std::greater<Event>());
+        const Event event = mQueue.back();
+        mQueue.pop_back();
+
+        if (event.countA != mCount[event.a] || (event.type == EventType::Pair && event.countB != mCount[event.b])) {
+            ++mStats.stale;
+            continue;
+        }
+
+        mTime = std::max(mTime, event.time);
+        ++mStats.events;
+        switch (event.type) {
+        case EventType::Pair:
+            collidePair(event.a, event.b);
+            ++mStats.collisions;
+            break;
+        case EventType::Wall:
+            collideWall(event.a, event.b);
+            ++mStats.collisions;
+            break;
+        case EventType::Cell:
+            crossCell(event.a, event.b);
+            break;
+        }
+    }
+    // Truncated runs stop at the last event, slowing down rather than missing collisions
+    if (!mStats.truncated) {
+        mTime = target;
+    }
+
+    // Stale entries pile up with every collision
+    if (mQueue.size() > 16 * count + 4096) {
+        compact();
+    }
+    mStats.queued = mQueue.size();
+
+    mWrittenPositions.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::vec3 position(positionAt(i, mTime));
+        if (position != components.transforms[i].position) {
+            components.transforms[i].position = position;
+            components.transformDirty[i] = 1;
+        }
+        components.physics[i].velocity = glm::vec3(mVelocity[i]);
+        mWrittenPositions[i] = position;
+    }
+    mWrittenPhysics.assign(components.physics.begin(), components.physics.end());
+    mWrittenBounds = bounds;
+}
+
+void EventSimulation::hashState(StateHash& hash) const {
+    const size_t count = mPosition.size();
+    hash.add(&mTime, sizeof(mTime));
+    hash.add(static_cast<uint64_t>(count));
+    hash.addArray(mPosition, count);
+    hash.addArray(mVelocity, count);
+    hash.addArray(mLocalTime, count);
+    hash.addArray(mCount, count);
+}
+
+void EventSimulation::saveState(Snapshot& snapshot, const ComponentArrays& components,
+    const WorldBoundsComponent& bounds) const {
+    snapshot.synced = inSync(components, bounds);
+    if (!snapshot.synced) return;
+
+    snapshot.time = mTime;
+    snapshot.position.assign(mPosition.begin(), mPosition.end());
+    snapshot.velocity.assign(mVelocity.begin(), mVelocity.end());
+    snapshot.localTime.assign(mLocalTime.begin(), mLocalTime.end());
+    snapshot.count.assign(mCount.begin(), mCount.end());
+    snapshot.cell.assign(mCell.begin(), mCell.end());
+}
+
+void EventSimulation::restoreState(const Snapshot& snapshot, const ComponentArrays& components,
+    const WorldBoundsComponent& bounds) {
+    const size_t count = components.physics.size();
+    if (!snapshot.synced || snapshot.position.size() != count) {
+        // Out of sync on purpose: advance() reschedules from the components
+        mWrittenPhysics.clear();
+        mWrittenPositions.clear();
+        return;
+    }
+
+    mTime = snapshot.time;
+    mPosition = snapshot.position;
+    mVelocity = snapshot.velocity;
+    mLocalTime = snapshot.localTime;
+    mCount = snapshot.count;
+    rebuild(components, bounds, &snapshot.cell);
+
+    // The restored components are what advance() had written when the snapshot was saved
+    mWrittenPositions.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        mWrittenPositions[i] = components.transforms[i].position;
+    }
+    mWrittenPhysics.assign(components.physics.begin(), components.physics.end());
+    mWrittenBounds = bounds;
+}
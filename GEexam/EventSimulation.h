@@ -0,0 +1,140 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <tuple>
+#include <glm/glm.hpp>
+#include "ComponentManager.h"
+#include "StateHash.h"
+
+// Work of the last advance()
+struct EventStats {
+    size_t events = 0;          // Collisions and cell crossings handled
+    size_t collisions = 0;      // Sphere-sphere and sphere-wall
+    size_t stale = 0;           // Popped events invalidated by an earlier collision
+    size_t queued = 0;          // Queue size afterwards, stale entries included
+    bool rescheduled = false;   // State changed outside, every event was predicted again
+    bool truncated = false;     // Hit the event limit, the spheres stopped short of the step
+};
+
+// Event-driven simulation of freely flying spheres, as in molecular dynamics: the time of
+// every future sphere-sphere and sphere-wall impact is solved exactly and kept in a
+// priority queue, and the simulation jumps from one event to the next. Spheres carry their
+// own clock and are only moved when an event touches them. Each sphere has a collision
+// counter; events remember the counters they were predicted with and are dropped when
+// popped after either sphere has collided since (lazy invalidation). A cell list limits
+// predictions to neighbouring spheres, with cell crossings as events of their own.
+// Cost follows the number of events rather than spheres x steps. Collisions are elastic.
+class EventSimulation {
+public:
+    static constexpr int MAX_CELLS_PER_AXIS = 64;
+    static constexpr double SPHERES_PER_CELL = 0.25;
+
+    // The clock and each sphere's kinematic state. The queue and cell lists are predicted
+    // again from it on restore instead of being copied.
+    struct Snapshot {
+        bool synced = false;        // Matched the components when saved
+        double time = 0.0;
+        std::vector<glm::dvec3> position;
+        std::vector<glm::dvec3> velocity;
+        std::vector<double> localTime;
+        std::vector<uint32_t> count;
+        std::vector<glm::ivec3> cell;
+    };
+
+    // Runs every event up to deltaTime ahead and writes the spheres' positions and
+    // velocities at that time. Changes made to the components since the last call (new
+    // spheres, forces, a restored snapshot) are picked up by predicting everything again.
+    void advance(ComponentArrays& components, const WorldBoundsComponent& bounds, float deltaTime, size_t maxEvents);
+
+    const EventStats& getStats() const { return mStats; }
+
+    // Adds the clock and each sphere's kinematic state to hash. The queue and cell list are
+    // predicted from these, so they are left out.
+    void hashState(StateHash& hash) const;
+
+    void saveState(Snapshot& snapshot, const ComponentArrays& components, const WorldBoundsComponent& bounds) const;
+
+    // Call with the components already restored. Every event is predicted again from the
+    // restored sphere clocks. Predictions only depend on those, so the rebuilt queue replays
+    // the run the snapshot was taken from exactly. A snapshot saved out of sync just makes
+    // the next advance() start over from the components.
+    void restoreState(const Snapshot& snapshot, const ComponentArrays& components, const WorldBoundsComponent& bounds);
+
+private:
+    enum class EventType : uint8_t { Pair, Wall, Cell };
+
+    struct Event {
+        double time;
+        uint32_t a;
+        uint32_t b;             // Other sphere, or the axis of a wall or cell crossing
+        uint32_t countA;
+        uint32_t countB;
+        EventType type;
+
+        // Total order, so events at the same time pop in the same order whatever the
+        // queue's history
+        bool operator>(const Event& other) const {
+            if (time != other.time) return time > other.time;
+            return std::tie(a, b, type, countA, countB) > std::tie(other.a, other.b, other.type, other.countA, other.countB);
+        }
+    };
+
+    bool inSync(const ComponentArrays& components, const WorldBoundsComponent& bounds) const;
+    void reschedule(const ComponentArrays& components, const WorldBoundsComponent& bounds);
+
+    // Radii, masses and the cell grid for the kinematic state in place, then the queue.
+    // cells: each sphere's cell, or nullptr to place them by position.
+    void rebuild(const ComponentArrays& components, const WorldBoundsComponent& bounds, const std::vector<glm::ivec3>* cells);
+
+    // Drops the queue and predicts every event again from the current state, to shed
+    // the stale entries
+    void compact();
+    void push(const Event& event);
+
+    // Predicts the wall, cell crossing and neighbour events of sphere i. Times are worked
+    // out from the spheres' own clocks rather than mTime, which only move on collisions,
+    // so an event predicted again later comes out bit-identical and a queue rebuilt from
+    // the kinematic state replays exactly. onlyAbove skips neighbours with a lower index,
+    // for scheduling everything at once.
+    void predict(uint32_t i, bool onlyAbove = false);
+    void predictPair(uint32_t i, uint32_t j);
+
+    glm::dvec3 positionAt(uint32_t i, double time) const;
+    void moveTo(uint32_t i, double time);
+
+    void collidePair(uint32_t i, uint32_t j);
+    void collideWall(uint32_t i, uint32_t axis);
+    void crossCell(uint32_t i, uint32_t axis);
+
+    int cellIndex(const glm::ivec3& cell) const { return (cell.z * mDims.y + cell.y) * mDims.x + cell.x; }
+    void link(uint32_t i);
+    void unlink(uint32_t i);
+
+    EventStats mStats;
+    double mTime = 0.0;
+
+    // Per sphere, position at its own clock mLocalTime
+    std::vector<glm::dvec3> mPosition;
+    std::vector<glm::dvec3> mVelocity;
+    std::vector<double> mLocalTime;
+    std::vector<double> mRadius;
+    std::vector<double> mInverseMass;
+    std::vector<uint32_t> mCount;
+
+    // Cell list: per cell a doubly linked list through the spheres
+    glm::dvec3 mBoundsMin{ 0.0 }, mBoundsMax{ 0.0 };
+    glm::dvec3 mCellSize{ 1.0 };
+    glm::ivec3 mDims{ 1 };
+    std::vector<int> mCellHead;
+    std::vector<glm::ivec3> mCell;
+    std::vector<int> mNext, mPrev;
+
+    // Min-heap on time, a plain vector so clearing keeps its storage
+    std::vector<Event> mQueue;
+
+    // What the last advance() wrote, to notice outside changes
+    std::vector<glm::vec3> mWrittenPositions;
+    std::vector<PhysicsComponent> mWrittenPhysics;
+    WorldBoundsComponent mWrittenBounds;
+};
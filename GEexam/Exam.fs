@@ -3,6 +3,9 @@ out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
+#if defined(INSTANCED) || defined(VERTEX_COLOR)
+in vec3 InstanceColor;
+#endif
 
 uniform vec3 lightPos;
 uniform vec3 viewPos;
@@ -11,9 +14,15 @@ uniform vec3 objectColor;
 uniform bool useFlatColor; 
 
 void main() {
+#if defined(INSTANCED) || defined(VERTEX_COLOR)
+    vec3 baseColor = InstanceColor;
+#else
+    vec3 baseColor = objectColor;
+#endif
+
     if (useFlatColor) {
         // Use flat color without lighting
-        FragColor = vec4(objectColor, 1.0);
+        FragColor = vec4(baseColor, 1.0);
         return;
     }
 
@@ -38,6 +47,6 @@ void main() {
     vec3 specular = specularStrength * spec * lightColor;
 
     // Resulting color
-    vec3 result = (ambient + diffuse + specular) * objectColor;
+    vec3 result = (ambient + diffuse + specular) * baseColor;
     FragColor = vec4(result, 1.0);
 }
@@ -2,6 +2,19 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 
+#ifdef INSTANCED
+// Per-instance data, filled on the CPU by TransformSystem
+layout (location = 2) in mat4 aModel;
+layout (location = 6) in mat3 aNormalMatrix;
+#endif
+
+#if defined(INSTANCED) || defined(VERTEX_COLOR)
+// Per-instance colour, or per-vertex colour for particles with colour over life
+layout (location = 9) in vec3 aColor;
+
+out vec3 InstanceColor;
+#endif
+
 out vec3 FragPos;
 out vec3 Normal;
 
@@ -10,8 +23,25 @@ uniform mat4 view;
 uniform mat4 projection;
 
 void main() {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+#ifdef INSTANCED
+    mat4 world = aModel;
+#else
+    mat4 world = model;
+#endif
+#if defined(INSTANCED) || defined(VERTEX_COLOR)
+    InstanceColor = aColor;
+#endif
+
+    FragPos = vec3(world * vec4(aPos, 1.0));
+
+#if defined(INSTANCED) && defined(UNIFORM_SCALE)
+    // Translation + uniform scale: the fragment shader normalizes, so no normal matrix is needed
+    Normal = mat3(world) * aNormal;
+#elif defined(INSTANCED)
+    Normal = aNormalMatrix * aNormal;
+#else
     Normal = mat3(transpose(inverse(model))) * aNormal;
+#endif
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
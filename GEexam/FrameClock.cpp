@@ -0,0 +1,22 @@
+#include "FrameClock.h"
+#include <algorithm>
+
+// Longer gaps (debugger breaks, window drags) count as one very slow frame
+const double MAX_FRAME_SECONDS = 0.25;
+
+FrameClock::FrameClock(double fixedStep, int maxSteps)
+    : mFixedStep(fixedStep), mMaxSteps(std::max(maxSteps, 1)) {
+}
+
+int FrameClock::advance(double frameSeconds) {
+    mAccumulator += std::min(std::max(frameSeconds, 0.0), MAX_FRAME_SECONDS);
+
+    int steps = static_cast<int>(mAccumulator / mFixedStep);
+    mAccumulator = std::max(mAccumulator - steps * mFixedStep, 0.0);
+
+    if (steps > mMaxSteps) {
+        mDroppedSteps += steps - mMaxSteps;
+        steps = mMaxSteps;
+    }
+    return steps;
+}
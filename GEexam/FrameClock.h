@@ -0,0 +1,30 @@
+#pragma once
+
+// Turns variable frame times into a whole number of fixed simulation steps.
+// Leftover time carries to the next frame and gives the render interpolation factor.
+class FrameClock {
+public:
+    static constexpr double DEFAULT_STEP = 1.0 / 60.0;
+    static constexpr int DEFAULT_MAX_STEPS = 5;
+
+    // maxSteps caps the catch-up per frame; time beyond it is dropped, so a slow frame
+    // slows the simulation down instead of making every later frame slower still
+    explicit FrameClock(double fixedStep = DEFAULT_STEP, int maxSteps = DEFAULT_MAX_STEPS);
+
+    // Adds a frame's real duration and returns the number of fixed steps to run
+    int advance(double frameSeconds);
+
+    float getFixedStep() const { return static_cast<float>(mFixedStep); }
+
+    // 0..1: how far the frame is past the last step, towards the next one
+    float getInterpolation() const { return static_cast<float>(mAccumulator / mFixedStep); }
+
+    // Steps skipped by the catch-up cap since construction
+    long long getDroppedSteps() const { return mDroppedSteps; }
+
+private:
+    double mFixedStep;
+    int mMaxSteps;
+    double mAccumulator = 0.0;
+    long long mDroppedSteps = 0;
+};
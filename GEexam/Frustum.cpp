@@ -0,0 +1,109 @@
+#include "Frustum.h"
+#include "Simd.h"
+
+void Frustum::extract(const glm::mat4& viewProjection) {
+    // Gribb/Hartmann: planes are sums/differences of the matrix rows (glm is column-major)
+    glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    mPlanes[0] = row3 + row0; // Left
+    mPlanes[1] = row3 - row0; // Right
+    mPlanes[2] = row3 + row1; // Bottom
+    mPlanes[3] = row3 - row1; // Top
+    mPlanes[4] = row3 + row2; // Near
+    mPlanes[5] = row3 - row2; // Far
+
+    // Normalize so the plane distance is in world units and can be compared to a radius
+    for (glm::vec4& plane : mPlanes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    mStats = CullStats();
+}
+
+bool Frustum::insideAllPlanes(float x, float y, float z, float radius) const {
+    for (const glm::vec4& plane : mPlanes) {
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::testSphere(const glm::vec3& center, float radius) {
+    bool visible = insideAllPlanes(center.x, center.y, center.z, radius);
+    mStats.tested++;
+    mStats.visible += visible ? 1 : 0;
+    return visible;
+}
+
+size_t Frustum::cullSpheres(const float* x, const float* y, const float* z, const float* radius,
+    size_t count, uint32_t* outVisible) {
+    size_t visibleCount = 0;
+    size_t i = 0;
+
+#if defined(GE_SIMD_AVX)
+    for (; i + 8 <= count; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 pz = _mm256_loadu_ps(z + i);
+        __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const glm::vec4& plane : mPlanes) {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(plane.x)), _mm256_mul_ps(py, _mm256_set1_ps(plane.y))),
+                _mm256_add_ps(_mm256_mul_ps(pz, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        while (mask) {
+            int lane = 0;
+            while (!(mask & (1 << lane))) ++lane;
+            outVisible[visibleCount++] = static_cast<uint32_t>(i + lane);
+            mask &= mask - 1;
+        }
+    }
+#elif defined(GE_SIMD_SSE)
+    // Two 4-wide halves per block of 8
+    for (; i + 8 <= count; i += 8) {
+        int mask = 0;
+        for (size_t half = 0; half < 8; half += 4) {
+            __m128 px = _mm_loadu_ps(x + i + half);
+            __m128 py = _mm_loadu_ps(y + i + half);
+            __m128 pz = _mm_loadu_ps(z + i + half);
+            __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i + half));
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const glm::vec4& plane : mPlanes) {
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(plane.x)), _mm_mul_ps(py, _mm_set1_ps(plane.y))),
+                    _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+            }
+            mask |= _mm_movemask_ps(inside) << half;
+        }
+
+        while (mask) {
+            int lane = 0;
+            while (!(mask & (1 << lane))) ++lane;
+            outVisible[visibleCount++] = static_cast<uint32_t>(i + lane);
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // Scalar tail (and the whole range without SIMD)
+    for (; i < count; ++i) {
+        if (insideAllPlanes(x[i], y[i], z[i], radius[i])) {
+            outVisible[visibleCount++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    mStats.tested += count;
+    mStats.visible += visibleCount;
+    return visibleCount;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Culling counters for one frame
+struct CullStats {
+    size_t tested = 0;
+    size_t visible = 0;
+};
+
+class Frustum {
+public:
+    // Extracts the six planes from projection * view and resets the stats
+    void extract(const glm::mat4& viewProjection);
+
+    bool testSphere(const glm::vec3& center, float radius);
+
+    // Tests spheres from SoA streams 8 at a time and writes the indices of the
+    // visible ones to outVisible (must hold count entries). Returns the visible count.
+    size_t cullSpheres(const float* x, const float* y, const float* z, const float* radius,
+        size_t count, uint32_t* outVisible);
+
+    const CullStats& getStats() const { return mStats; }
+
+private:
+    glm::vec4 mPlanes[6];
+    CullStats mStats;
+
+    bool insideAllPlanes(float x, float y, float z, float radius) const;
+};
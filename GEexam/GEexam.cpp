@@ -6,102 +6,14 @@
 #include "Shader.h"
 #include "Spheres.h"
 #include "World.h"
+#include "StreamingBuffer.h"
+#include "FrameClock.h"
+#include "ScriptBindings.h"
 
 
-//Lua includes
-extern "C"
-{
-#include "lua54/include/lua.h"
-#include "lua54/include/lauxlib.h"
-#include "lua54/include/lualib.h"
-}
-
-// Link to lua library
-#ifdef _WIN32
-#pragma comment(lib, "lua54/lua54.lib")
-#endif
-
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window, Camera& camera, bool& shouldReloadScript);
 
-
-ComponentArrays gComponents;
-
-int lua_createEntity(lua_State* L) {
-    uint32_t entity = gComponents.transforms.size();
-    gComponents.resize(entity + 1);
-
-    std::cout << "Lua created entity ID: " << entity << std::endl;
-
-    lua_pushinteger(L, entity); // Return entity ID
-    return 1; // Number of return values
-}
-
-
-
-int lua_setPosition(lua_State* L) {
-    uint32_t entity = lua_tointeger(L, 1); // Get entity ID
-    float x = lua_tonumber(L, 2);          // Get x coordinate
-    float y = lua_tonumber(L, 3);          // Get y coordinate
-    float z = lua_tonumber(L, 4);          // Get z coordinate
-
-
-    if (entity < gComponents.transforms.size()) {
-        gComponents.transforms[entity].position = { x, y, z };
-    }
-    else {
-        std::cerr << "Invalid entity ID: " << entity << std::endl;
-    }
-
-    return 0; // No return values
-}
-
-int lua_setVelocity(lua_State* L) {
-    uint32_t entity = lua_tointeger(L, 1);
-    float vx = lua_tonumber(L, 2);
-    float vy = lua_tonumber(L, 3);
-    float vz = lua_tonumber(L, 4);
-
-    if (entity < gComponents.physics.size()) {
-        gComponents.physics[entity].velocity = { vx, vy, vz };
-    }
-    else {
-        std::cerr << "Invalid entity ID: " << entity << std::endl;
-    }
-
-    return 0;
-}
-
-int lua_setColor(lua_State* L) {
-    uint32_t entity = lua_tointeger(L, 1);
-    float r = lua_tonumber(L, 2);
-    float g = lua_tonumber(L, 3);
-    float b = lua_tonumber(L, 4);
-
-    if (entity < gComponents.renders.size()) {
-        gComponents.renders[entity].color = { r, g, b };
-    }
-    else {
-        std::cerr << "Invalid entity ID: " << entity << std::endl;
-    }
-
-    return 0;
-}
-
-
-// Register functions in Lua
-void registerLuaFunctions(lua_State* L) {
-
-    int lua_setVelocity(lua_State * L);
-    int lua_setPosition(lua_State * L);
-    int lua_setColor(lua_State * L);
-
-    lua_register(L, "createEntity", lua_createEntity);
-    lua_register(L, "setPosition", lua_setPosition);
-    lua_register(L, "setVelocity", lua_setVelocity);
-    lua_register(L, "setColor", lua_setColor);
-}
-
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
 
@@ -137,6 +49,7 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    StreamingBuffer::loadExtensions((GLADloadproc)glfwGetProcAddress);
 
     glEnable(GL_DEPTH_TEST);  // Enable depth testing
 
@@ -176,9 +89,17 @@ int main()
     std::unordered_set<uint32_t> processedEntities;
 
     // Load and execute the Lua script
+    resetScriptSettings();
     if (luaL_dofile(L, "myLua.lua") != LUA_OK) {
         std::cerr << "Error loading Lua script: " << lua_tostring(L, -1) << std::endl;
     }
+    else {
+        if (gParticleEffectDefined) world.setParticleEffect(gParticleEffect);
+        if (gPhysicsSettingsDefined) world.setPhysicsSettings(gPhysicsSettings);
+        for (size_t box = 0; box < gParticlePriorities.size(); ++box) {
+            world.setParticlePriority(box, gParticlePriorities[box]);
+        }
+    }
 
     
     for (size_t i = 0; i < gComponents.transforms.size(); ++i) {
@@ -198,14 +119,23 @@ int main()
    
     bool shouldReloadScript = false;
 
+    // Physics on its own thread from here on, overlapping the rendering below
+    world.setThreaded(true);
+
     //-----------------------------------------------------------------------------------------------//
     //-----------------------------------------RenderLoop--------------------------------------------//
     //-----------------------------------------------------------------------------------------------//
 
-    float deltaTime = 0.016f;
+    // Simulation at a fixed 60 Hz, rendering at whatever rate the swap allows
+    FrameClock frameClock;
+    double lastFrameTime = glfwGetTime();
 
     while (!glfwWindowShouldClose(window))
     {
+        double frameTime = glfwGetTime();
+        int steps = frameClock.advance(frameTime - lastFrameTime);
+        lastFrameTime = frameTime;
+
         camera.processInput(window);
         processInput(window, camera, shouldReloadScript);
 
@@ -218,12 +148,19 @@ int main()
                 processedEntities.insert(i);
             }
 
+            resetScriptSettings();
             if (luaL_dofile(L, "myLua.lua") != LUA_OK) {
                 std::cerr << "Error reloading Lua script: " << lua_tostring(L, -1) << std::endl;
             }
             else {
                 std::cout << "Lua script reloaded successfully! Entities: " << gComponents.transforms.size() << "\n";
 
+                if (gParticleEffectDefined) world.setParticleEffect(gParticleEffect);
+                if (gPhysicsSettingsDefined) world.setPhysicsSettings(gPhysicsSettings);
+                for (size_t box = 0; box < gParticlePriorities.size(); ++box) {
+                    world.setParticlePriority(box, gParticlePriorities[box]);
+                }
+
                 // Add only new entities created by Lua
                 for (size_t i = 0; i < gComponents.transforms.size(); ++i) {
                     if (processedEntities.find(i) == processedEntities.end()) {
@@ -245,24 +182,44 @@ int main()
             shouldReloadScript = false;
         }
 
-        world.update(deltaTime);
+        for (int step = 0; step < steps; ++step) {
+            world.update(frameClock.getFixedStep());
+        }
 
         
 
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        world.setViewport(framebufferWidth, framebufferHeight);
+
         glm::mat4 view = glm::lookAt(camera.position, camera.position + camera.orientation, camera.up);
         glm::mat4 projection = glm::perspective(glm::radians(60.0f), 800.0f / 600.0f, 0.1f, 10000.0f);
         glm::mat4 model = glm::mat4(1.0f);
 
-        world.render(ourShader, view, projection);
+        world.render(ourShader, view, projection, frameClock.getInterpolation());
+
+        // Show culling stats in the title once a second
+        static int statsFrame = 0;
+        if (++statsFrame >= 60) {
+            statsFrame = 0;
+            const CullStats& stats = world.getCullStats();
+            const ParticleBudgetStats& particles = world.getParticleBudgetStats();
+            std::string title = "Test Win - culled " + std::to_string(stats.tested - stats.visible) +
+                " of " + std::to_string(stats.tested) +
+                " - particles " + std::to_string(particles.alive) + " / " + std::to_string(particles.scaledMaxParticles) +
+                " (" + std::to_string(static_cast<int>(particles.usage() * 100.0f)) + "% of budget)";
+            glfwSetWindowTitle(window, title.c_str());
+        }
         
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    world.setThreaded(false);
     glfwTerminate();
     lua_close(L);
     return 0;
@@ -0,0 +1,360 @@
+#include "GLRecorder.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    GLRecorder::Mode sMode = GLRecorder::Mode::Null;
+    bool sInstalled = false;
+
+    GLFrameStats sFrame;
+    GLFrameStats sTotals;
+    BufferTimingModel sTiming;
+
+    // Bookkeeping for the implicit-sync model
+    int64_t sFrameIndex = 0;
+    GLuint sNextName = 1;
+    GLuint sBoundArrayBuffer = 0;
+    GLuint sBoundElementBuffer = 0;
+    GLuint sBoundVAO = 0;
+    std::unordered_map<GLuint, std::vector<GLuint>> sVAOBuffers;
+    std::unordered_map<GLuint, int64_t> sBufferLastDrawn;
+
+    void spin(double nanoseconds) {
+        if (nanoseconds <= 0.0) return;
+
+        sFrame.emulatedUploadMs += nanoseconds * 1e-6;
+        sTotals.emulatedUploadMs += nanoseconds * 1e-6;
+        auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(static_cast<int64_t>(nanoseconds));
+        while (std::chrono::steady_clock::now() < end) {
+        }
+    }
+
+    void trackVAOBuffer(GLuint buffer) {
+        std::vector<GLuint>& buffers = sVAOBuffers[sBoundVAO];
+        if (std::find(buffers.begin(), buffers.end(), buffer) == buffers.end()) {
+            buffers.push_back(buffer);
+        }
+    }
+
+    void countState() { sFrame.stateChanges++; sTotals.stateChanges++; }
+    void countUniform() { sFrame.uniformUploads++; sTotals.uniformUploads++; }
+
+    void countDraw(bool instanced) {
+        sFrame.drawCalls++;
+        sTotals.drawCalls++;
+        if (instanced) {
+            sFrame.instancedDrawCalls++;
+            sTotals.instancedDrawCalls++;
+        }
+
+        // Everything the VAO reads is now in flight
+        auto it = sVAOBuffers.find(sBoundVAO);
+        if (it != sVAOBuffers.end()) {
+            for (GLuint buffer : it->second) {
+                sBufferLastDrawn[buffer] = sFrameIndex;
+            }
+        }
+    }
+
+    GLuint boundBuffer(GLenum target) {
+        return target == GL_ELEMENT_ARRAY_BUFFER ? sBoundElementBuffer : sBoundArrayBuffer;
+    }
+
+    void countUpload(GLenum target, size_t bytes, bool orphan) {
+        GLuint buffer = boundBuffer(target);
+        if (orphan) {
+            // Fresh storage, the GPU no longer holds the old one
+            sFrame.orphans++;
+            sTotals.orphans++;
+            sBufferLastDrawn.erase(buffer);
+            spin(sTiming.orphanNanoseconds);
+            return;
+        }
+
+        sFrame.bufferUploads++;
+        sTotals.bufferUploads++;
+        sFrame.bytesUploaded += bytes;
+        sTotals.bytesUploaded += bytes;
+
+        auto it = sBufferLastDrawn.find(buffer);
+        if (it != sBufferLastDrawn.end() && sFrameIndex - it->second < sTiming.framesInFlight) {
+            sFrame.implicitSyncs++;
+            sTotals.implicitSyncs++;
+            spin(sTiming.implicitSyncNanoseconds);
+        }
+        spin(sTiming.nanosecondsPerByte * static_cast<double>(bytes));
+    }
+}
+
+// Real entry points, only set in Forward mode
+#define GE_REAL(name) static decltype(glad_##name) sReal_##name = nullptr;
+GE_REAL(glGenVertexArrays) GE_REAL(glGenBuffers) GE_REAL(glBindVertexArray) GE_REAL(glBindBuffer)
+GE_REAL(glBufferData) GE_REAL(glBufferSubData) GE_REAL(glVertexAttribPointer) GE_REAL(glEnableVertexAttribArray)
+GE_REAL(glDisableVertexAttribArray) GE_REAL(glVertexAttribDivisor) GE_REAL(glDrawArrays) GE_REAL(glDrawElements) GE_REAL(glDrawArraysInstanced)
+GE_REAL(glUseProgram) GE_REAL(glGetUniformLocation) GE_REAL(glUniform1i) GE_REAL(glUniform1f)
+GE_REAL(glUniform3fv) GE_REAL(glUniformMatrix4fv) GE_REAL(glPointSize) GE_REAL(glEnable)
+GE_REAL(glViewport) GE_REAL(glClearColor) GE_REAL(glClear) GE_REAL(glGetIntegerv) GE_REAL(glGetStringi)
+GE_REAL(glMapBufferRange) GE_REAL(glFenceSync) GE_REAL(glClientWaitSync) GE_REAL(glDeleteSync)
+GE_REAL(glCreateShader) GE_REAL(glShaderSource) GE_REAL(glCompileShader) GE_REAL(glGetShaderiv)
+GE_REAL(glGetShaderInfoLog) GE_REAL(glDeleteShader) GE_REAL(glCreateProgram) GE_REAL(glAttachShader)
+GE_REAL(glLinkProgram) GE_REAL(glGetProgramiv) GE_REAL(glGetProgramInfoLog)
+#undef GE_REAL
+
+// Objects
+static void APIENTRY recGenVertexArrays(GLsizei n, GLuint* arrays) {
+    if (sReal_glGenVertexArrays) { sReal_glGenVertexArrays(n, arrays); return; }
+    for (GLsizei i = 0; i < n; ++i) arrays[i] = sNextName++;
+}
+static void APIENTRY recGenBuffers(GLsizei n, GLuint* buffers) {
+    if (sReal_glGenBuffers) { sReal_glGenBuffers(n, buffers); return; }
+    for (GLsizei i = 0; i < n; ++i) buffers[i] = sNextName++;
+}
+
+// State
+static void APIENTRY recBindVertexArray(GLuint array) {
+    countState();
+    sBoundVAO = array;
+    if (sReal_glBindVertexArray) sReal_glBindVertexArray(array);
+}
+static void APIENTRY recBindBuffer(GLenum target, GLuint buffer) {
+    countState();
+    if (target == GL_ELEMENT_ARRAY_BUFFER) {
+        sBoundElementBuffer = buffer;
+        if (sBoundVAO != 0) trackVAOBuffer(buffer);
+    }
+    else if (target == GL_ARRAY_BUFFER) {
+        sBoundArrayBuffer = buffer;
+    }
+    if (sReal_glBindBuffer) sReal_glBindBuffer(target, buffer);
+}
+static void APIENTRY recVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+    countState();
+    trackVAOBuffer(sBoundArrayBuffer);
+    if (sReal_glVertexAttribPointer) sReal_glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+static void APIENTRY recEnableVertexAttribArray(GLuint index) {
+    countState();
+    if (sReal_glEnableVertexAttribArray) sReal_glEnableVertexAttribArray(index);
+}
+static void APIENTRY recDisableVertexAttribArray(GLuint index) {
+    countState();
+    if (sReal_glDisableVertexAttribArray) sReal_glDisableVertexAttribArray(index);
+}
+static void APIENTRY recVertexAttribDivisor(GLuint index, GLuint divisor) {
+    countState();
+    if (sReal_glVertexAttribDivisor) sReal_glVertexAttribDivisor(index, divisor);
+}
+static void APIENTRY recUseProgram(GLuint program) {
+    countState();
+    if (sReal_glUseProgram) sReal_glUseProgram(program);
+}
+static void APIENTRY recPointSize(GLfloat size) {
+    countState();
+    if (sReal_glPointSize) sReal_glPointSize(size);
+}
+static void APIENTRY recEnable(GLenum cap) {
+    countState();
+    if (sReal_glEnable) sReal_glEnable(cap);
+}
+static void APIENTRY recViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    countState();
+    if (sReal_glViewport) sReal_glViewport(x, y, width, height);
+}
+static void APIENTRY recClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+    countState();
+    if (sReal_glClearColor) sReal_glClearColor(r, g, b, a);
+}
+static void APIENTRY recClear(GLbitfield mask) {
+    if (sReal_glClear) sReal_glClear(mask);
+}
+
+// Uploads
+static void APIENTRY recBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    countUpload(target, static_cast<size_t>(size), data == nullptr);
+    if (data != nullptr) {
+        // A full re-specification with data is also fresh storage
+        sBufferLastDrawn.erase(boundBuffer(target));
+    }
+    if (sReal_glBufferData) sReal_glBufferData(target, size, data, usage);
+}
+static void APIENTRY recBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    countUpload(target, static_cast<size_t>(size), false);
+    if (sReal_glBufferSubData) sReal_glBufferSubData(target, offset, size, data);
+}
+static void* APIENTRY recMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    countState();
+    return sReal_glMapBufferRange ? sReal_glMapBufferRange(target, offset, length, access) : nullptr;
+}
+
+// Draws
+static void APIENTRY recDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    countDraw(false);
+    if (sReal_glDrawArrays) sReal_glDrawArrays(mode, first, count);
+}
+static void APIENTRY recDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    countDraw(false);
+    if (sReal_glDrawElements) sReal_glDrawElements(mode, count, type, indices);
+}
+static void APIENTRY recDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+    countDraw(true);
+    if (sReal_glDrawArraysInstanced) sReal_glDrawArraysInstanced(mode, first, count, instancecount);
+}
+
+// Uniforms
+static GLint APIENTRY recGetUniformLocation(GLuint program, const GLchar* name) {
+    return sReal_glGetUniformLocation ? sReal_glGetUniformLocation(program, name) : 0;
+}
+static void APIENTRY recUniform1i(GLint location, GLint v0) {
+    countUniform();
+    if (sReal_glUniform1i) sReal_glUniform1i(location, v0);
+}
+static void APIENTRY recUniform1f(GLint location, GLfloat v0) {
+    countUniform();
+    if (sReal_glUniform1f) sReal_glUniform1f(location, v0);
+}
+static void APIENTRY recUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+    countUniform();
+    if (sReal_glUniform3fv) sReal_glUniform3fv(location, count, value);
+}
+static void APIENTRY recUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    countUniform();
+    if (sReal_glUniformMatrix4fv) sReal_glUniformMatrix4fv(location, count, transpose, value);
+}
+
+// Queries and sync
+static void APIENTRY recGetIntegerv(GLenum pname, GLint* data) {
+    if (sReal_glGetIntegerv) { sReal_glGetIntegerv(pname, data); return; }
+    *data = 0;
+}
+static const GLubyte* APIENTRY recGetStringi(GLenum name, GLuint index) {
+    return sReal_glGetStringi ? sReal_glGetStringi(name, index) : nullptr;
+}
+static GLsync APIENTRY recFenceSync(GLenum condition, GLbitfield flags) {
+    if (sReal_glFenceSync) return sReal_glFenceSync(condition, flags);
+    return reinterpret_cast<GLsync>(static_cast<uintptr_t>(sNextName++));
+}
+static GLenum APIENTRY recClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+    return sReal_glClientWaitSync ? sReal_glClientWaitSync(sync, flags, timeout) : GL_ALREADY_SIGNALED;
+}
+static void APIENTRY recDeleteSync(GLsync sync) {
+    if (sReal_glDeleteSync) sReal_glDeleteSync(sync);
+}
+
+// Shaders
+static GLuint APIENTRY recCreateShader(GLenum type) {
+    return sReal_glCreateShader ? sReal_glCreateShader(type) : sNextName++;
+}
+static void APIENTRY recShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) {
+    if (sReal_glShaderSource) sReal_glShaderSource(shader, count, string, length);
+}
+static void APIENTRY recCompileShader(GLuint shader) {
+    if (sReal_glCompileShader) sReal_glCompileShader(shader);
+}
+static void APIENTRY recGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+    if (sReal_glGetShaderiv) { sReal_glGetShaderiv(shader, pname, params); return; }
+    *params = GL_TRUE;
+}
+static void APIENTRY recGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+    if (sReal_glGetShaderInfoLog) { sReal_glGetShaderInfoLog(shader, bufSize, length, infoLog); return; }
+    if (length) *length = 0;
+    if (bufSize > 0) infoLog[0] = '\0';
+}
+static void APIENTRY recDeleteShader(GLuint shader) {
+    if (sReal_glDeleteShader) sReal_glDeleteShader(shader);
+}
+static GLuint APIENTRY recCreateProgram() {
+    return sReal_glCreateProgram ? sReal_glCreateProgram() : sNextName++;
+}
+static void APIENTRY recAttachShader(GLuint program, GLuint shader) {
+    if (sReal_glAttachShader) sReal_glAttachShader(program, shader);
+}
+static void APIENTRY recLinkProgram(GLuint program) {
+    if (sReal_glLinkProgram) sReal_glLinkProgram(program);
+}
+static void APIENTRY recGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+    if (sReal_glGetProgramiv) { sReal_glGetProgramiv(program, pname, params); return; }
+    *params = GL_TRUE;
+}
+static void APIENTRY recGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+    if (sReal_glGetProgramInfoLog) { sReal_glGetProgramInfoLog(program, bufSize, length, infoLog); return; }
+    if (length) *length = 0;
+    if (bufSize > 0) infoLog[0] = '\0';
+}
+
+void GLRecorder::install(Mode mode) {
+    if (sInstalled) return;
+    sMode = mode;
+    sInstalled = true;
+
+    // Keep the loaded driver entry points in Forward mode, then route everything through the stubs
+#define GE_HOOK(name, stub) \
+    sReal_##name = (mode == Mode::Forward) ? glad_##name : nullptr; \
+    glad_##name = stub;
+
+    GE_HOOK(glGenVertexArrays, recGenVertexArrays)
+    GE_HOOK(glGenBuffers, recGenBuffers)
+    GE_HOOK(glBindVertexArray, recBindVertexArray)
+    GE_HOOK(glBindBuffer, recBindBuffer)
+    GE_HOOK(glBufferData, recBufferData)
+    GE_HOOK(glBufferSubData, recBufferSubData)
+    GE_HOOK(glVertexAttribPointer, recVertexAttribPointer)
+    GE_HOOK(glEnableVertexAttribArray, recEnableVertexAttribArray)
+    GE_HOOK(glDisableVertexAttribArray, recDisableVertexAttribArray)
+    GE_HOOK(glVertexAttribDivisor, recVertexAttribDivisor)
+    GE_HOOK(glDrawArrays, recDrawArrays)
+    GE_HOOK(glDrawElements, recDrawElements)
+    GE_HOOK(glDrawArraysInstanced, recDrawArraysInstanced)
+    GE_HOOK(glUseProgram, recUseProgram)
+    GE_HOOK(glGetUniformLocation, recGetUniformLocation)
+    GE_HOOK(glUniform1i, recUniform1i)
+    GE_HOOK(glUniform1f, recUniform1f)
+    GE_HOOK(glUniform3fv, recUniform3fv)
+    GE_HOOK(glUniformMatrix4fv, recUniformMatrix4fv)
+    GE_HOOK(glPointSize, recPointSize)
+    GE_HOOK(glEnable, recEnable)
+    GE_HOOK(glViewport, recViewport)
+    GE_HOOK(glClearColor, recClearColor)
+    GE_HOOK(glClear, recClear)
+    GE_HOOK(glGetIntegerv, recGetIntegerv)
+    GE_HOOK(glGetStringi, recGetStringi)
+    GE_HOOK(glMapBufferRange, recMapBufferRange)
+    GE_HOOK(glFenceSync, recFenceSync)
+    GE_HOOK(glClientWaitSync, recClientWaitSync)
+    GE_HOOK(glDeleteSync, recDeleteSync)
+    GE_HOOK(glCreateShader, recCreateShader)
+    GE_HOOK(glShaderSource, recShaderSource)
+    GE_HOOK(glCompileShader, recCompileShader)
+    GE_HOOK(glGetShaderiv, recGetShaderiv)
+    GE_HOOK(glGetShaderInfoLog, recGetShaderInfoLog)
+    GE_HOOK(glDeleteShader, recDeleteShader)
+    GE_HOOK(glCreateProgram, recCreateProgram)
+    GE_HOOK(glAttachShader, recAttachShader)
+    GE_HOOK(glLinkProgram, recLinkProgram)
+    GE_HOOK(glGetProgramiv, recGetProgramiv)
+    GE_HOOK(glGetProgramInfoLog, recGetProgramInfoLog)
+#undef GE_HOOK
+}
+
+bool GLRecorder::isInstalled() {
+    return sInstalled;
+}
+
+void GLRecorder::setTimingModel(const BufferTimingModel& model) {
+    sTiming = model;
+}
+
+void GLRecorder::beginFrame() {
+    sFrame = GLFrameStats();
+}
+
+GLFrameStats GLRecorder::endFrame() {
+    sFrameIndex++;
+    return sFrame;
+}
+
+const GLFrameStats& GLRecorder::getTotals() {
+    return sTotals;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// GL work issued during one frame
+struct GLFrameStats {
+    size_t drawCalls = 0;
+    size_t instancedDrawCalls = 0;
+    size_t stateChanges = 0;      // Program, VAO, buffer, attribute and fixed-function state
+    size_t uniformUploads = 0;
+    size_t bufferUploads = 0;     // glBufferData with data + glBufferSubData calls
+    size_t bytesUploaded = 0;
+    size_t orphans = 0;           // glBufferData(nullptr)
+    size_t implicitSyncs = 0;     // Sub-data writes into a buffer the GPU may still be reading
+    double emulatedUploadMs = 0.0;
+};
+
+// Optional cost model for buffer uploads, spun on the calling thread so CPU-side
+// timings include it. All zero (the default) disables emulation.
+struct BufferTimingModel {
+    double nanosecondsPerByte = 0.0;
+    double orphanNanoseconds = 0.0;
+    double implicitSyncNanoseconds = 0.0;   // Stall for updating a buffer drawn from in the last frames
+    int framesInFlight = 2;
+};
+
+// Thin GL dispatch layer: replaces the glad function pointers with recording stubs,
+// so nothing that calls GL has to change.
+//  - Forward: count every call, then call the real driver (glad must already be loaded).
+//  - Null: count every call and do nothing, for machines without a GPU or context.
+//    Object names are handed out from counters and queries report success.
+class GLRecorder {
+public:
+    enum class Mode {
+        Forward,
+        Null
+    };
+
+    static void install(Mode mode);
+    static bool isInstalled();
+
+    static void setTimingModel(const BufferTimingModel& model);
+
+    static void beginFrame();
+    static GLFrameStats endFrame();
+
+    // Running totals since install()
+    static const GLFrameStats& getTotals();
+};
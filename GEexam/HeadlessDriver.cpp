@@ -0,0 +1,68 @@
+#include "HeadlessDriver.h"
+#include <chrono>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+HeadlessDriver::HeadlessDriver(GLRecorder::Mode mode, int viewportWidth, int viewportHeight) {
+    GLRecorder::install(mode);
+
+    mShader = std::make_unique<Shader>("Exam.vs", "Exam.fs");
+    mWorld = std::make_unique<World>();
+    mWorld->setViewport(viewportWidth, viewportHeight);
+
+    // Same camera setup as the windowed loop
+    setCamera(glm::vec3(0.0f, 5.0f, 40.0f), glm::vec3(0.0f));
+    mProjection = glm::perspective(glm::radians(60.0f), 800.0f / 600.0f, 0.1f, 10000.0f);
+}
+
+void HeadlessDriver::setCamera(const glm::vec3& position, const glm::vec3& target) {
+    mView = glm::lookAt(position, target, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+HeadlessFrame HeadlessDriver::step(float deltaTime) {
+    HeadlessFrame frame;
+    GLRecorder::beginFrame();
+
+    auto start = std::chrono::steady_clock::now();
+    mWorld->update(deltaTime);
+    frame.updateMs = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    mWorld->render(*mShader, mView, mProjection);
+    frame.renderMs = millisecondsSince(start);
+
+    frame.gl = GLRecorder::endFrame();
+    return frame;
+}
+
+HeadlessReport HeadlessDriver::run(size_t frames, float deltaTime) {
+    HeadlessReport report;
+    report.frames = frames;
+
+    for (size_t i = 0; i < frames; ++i) {
+        HeadlessFrame frame = step(deltaTime);
+        report.averageUpdateMs += frame.updateMs;
+        report.averageRenderMs += frame.renderMs;
+        report.worstRenderMs = std::max(report.worstRenderMs, frame.renderMs);
+
+        report.totals.drawCalls += frame.gl.drawCalls;
+        report.totals.instancedDrawCalls += frame.gl.instancedDrawCalls;
+        report.totals.stateChanges += frame.gl.stateChanges;
+        report.totals.uniformUploads += frame.gl.uniformUploads;
+        report.totals.bufferUploads += frame.gl.bufferUploads;
+        report.totals.bytesUploaded += frame.gl.bytesUploaded;
+        report.totals.orphans += frame.gl.orphans;
+        report.totals.implicitSyncs += frame.gl.implicitSyncs;
+        report.totals.emulatedUploadMs += frame.gl.emulatedUploadMs;
+    }
+
+    if (frames > 0) {
+        report.averageUpdateMs /= static_cast<double>(frames);
+        report.averageRenderMs /= static_cast<double>(frames);
+    }
+    return report;
+}
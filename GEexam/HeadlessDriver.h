@@ -0,0 +1,41 @@
+#pragma once
+#include "World.h"
+#include "Shader.h"
+#include "GLRecorder.h"
+#include <memory>
+#include <glm/glm.hpp>
+
+// CPU cost of one simulated frame
+struct HeadlessFrame {
+    double updateMs = 0.0;
+    double renderMs = 0.0;
+    GLFrameStats gl;
+};
+
+struct HeadlessReport {
+    size_t frames = 0;
+    double averageUpdateMs = 0.0;
+    double averageRenderMs = 0.0;
+    double worstRenderMs = 0.0;
+    GLFrameStats totals;
+};
+
+// Steps a World without a window or GPU. The GL recorder is installed before the
+// World is built, so every GL call it makes - setup included - is counted.
+class HeadlessDriver {
+public:
+    HeadlessDriver(GLRecorder::Mode mode = GLRecorder::Mode::Null, int viewportWidth = 1280, int viewportHeight = 720);
+
+    World& getWorld() { return *mWorld; }
+
+    void setCamera(const glm::vec3& position, const glm::vec3& target);
+
+    HeadlessFrame step(float deltaTime);
+    HeadlessReport run(size_t frames, float deltaTime);
+
+private:
+    std::unique_ptr<World> mWorld;
+    std::unique_ptr<Shader> mShader;
+    glm::mat4 mView;
+    glm::mat4 mProjection;
+};
@@ -0,0 +1,171 @@
+#include "JointSolver.h"
+#include <algorithm>
+#include <cmath>
+
+void JointSolver::analyze(const ComponentArrays& components) {
+    const std::vector<SpringJoint>& joints = components.joints;
+    const size_t entityCount = components.physics.size();
+
+    mPatternEnds.resize(joints.size() * 2);
+    for (size_t j = 0; j < joints.size(); ++j) {
+        mPatternEnds[j * 2] = joints[j].a;
+        mPatternEnds[j * 2 + 1] = joints[j].b;
+    }
+    mPatternEntities = entityCount;
+
+    // Blocks in entity order, only for joined entities
+    mBlock.assign(entityCount, -1);
+    for (uint32_t entity : mPatternEnds) {
+        mBlock[entity] = 0;
+    }
+    mBodies.clear();
+    for (size_t entity = 0; entity < entityCount; ++entity) {
+        if (mBlock[entity] < 0) continue;
+        mBlock[entity] = static_cast<int>(mBodies.size());
+        mBodies.push_back(static_cast<uint32_t>(entity));
+    }
+
+    const int size = static_cast<int>(mBodies.size()) * 3;
+    std::vector<Eigen::Triplet<double>> entries;
+    entries.reserve(mBodies.size() * 9 + joints.size() * 18);
+    auto addBlock = [&](int row, int col) {
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                entries.emplace_back(row * 3 + r, col * 3 + c, 0.0);
+            }
+        }
+    };
+    for (size_t body = 0; body < mBodies.size(); ++body) {
+        addBlock(static_cast<int>(body), static_cast<int>(body));
+    }
+    for (const SpringJoint& joint : joints) {
+        addBlock(mBlock[joint.a], mBlock[joint.b]);
+        addBlock(mBlock[joint.b], mBlock[joint.a]);
+    }
+    mMatrix.resize(size, size);
+    mMatrix.setFromTriplets(entries.begin(), entries.end());
+    mMatrix.makeCompressed();
+
+    // Value offsets, so assembly writes straight into the matrix without searching
+    auto blockSlots = [&](int row, int col, std::vector<int>& out) {
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                out.push_back(slot(row * 3 + r, col * 3 + c));
+            }
+        }
+    };
+    mDiagonalSlots.clear();
+    for (size_t body = 0; body < mBodies.size(); ++body) {
+        blockSlots(static_cast<int>(body), static_cast<int>(body), mDiagonalSlots);
+    }
+    mJointSlots.clear();
+    for (const SpringJoint& joint : joints) {
+        int a = mBlock[joint.a];
+        int b = mBlock[joint.b];
+        blockSlots(a, a, mJointSlots);
+        blockSlots(b, b, mJointSlots);
+        blockSlots(a, b, mJointSlots);
+        blockSlots(b, a, mJointSlots);
+    }
+
+    mSolver.analyzePattern(mMatrix);
+    mRhs.resize(size);
+    mDeltaV.resize(size);
+}
+
+void JointSolver::solve(ComponentArrays& components, float deltaTime) {
+    const std::vector<SpringJoint>& joints = components.joints;
+    mStats = JointStats();
+    mStats.joints = joints.size();
+    if (joints.empty() || deltaTime <= 0.0f) return;
+
+    // Same graph as last time: keep the pattern and the symbolic factorization
+    bool changed = mPatternEntities != components.physics.size() || mPatternEnds.size() != joints.size() * 2;
+    for (size_t j = 0; j < joints.size() && !changed; ++j) {
+        changed = mPatternEnds[j * 2] != joints[j].a || mPatternEnds[j * 2 + 1] != joints[j].b;
+    }
+    if (changed) {
+        analyze(components);
+        mStats.analyzed = true;
+    }
+    mStats.bodies = mBodies.size();
+
+    const double dt = deltaTime;
+    double* values = mMatrix.valuePtr();
+    std::fill(values, values + mMatrix.nonZeros(), 0.0);
+    mRhs.setZero();
+
+    // Mass on the diagonal. Massless entities take no velocity change, their rows stay identity.
+    mFixed.resize(mBodies.size());
+    for (size_t body = 0; body < mBodies.size(); ++body) {
+        float mass = components.physics[mBodies[body]].mass;
+        mFixed[body] = mass <= 0.0f;
+        const int* diagonal = &mDiagonalSlots[body * 9];
+        for (int axis = 0; axis < 3; ++axis) {
+            values[diagonal[axis * 4]] = mFixed[body] ? 1.0 : mass;
+        }
+    }
+
+    for (size_t j = 0; j < joints.size(); ++j) {
+        const SpringJoint& joint = joints[j];
+        const glm::vec3 delta = components.transforms[joint.a].position - components.transforms[joint.b].position;
+        const double length = glm::length(delta);
+        if (length < 1e-6) continue;
+
+        const double n[3] = { delta.x / length, delta.y / length, delta.z / length };
+        const glm::vec3& va = components.physics[joint.a].velocity;
+        const glm::vec3& vb = components.physics[joint.b].velocity;
+        const double relative[3] = { va.x - vb.x, va.y - vb.y, va.z - vb.z };
+        const double normalSpeed = relative[0] * n[0] + relative[1] * n[1] + relative[2] * n[2];
+
+        // Force on a, the opposite on b
+        const double magnitude = -joint.stiffness * (length - joint.restLength) - joint.damping * normalSpeed;
+
+        // Position Jacobian k (nn' + (1 - L/l)(I - nn')), with the transverse term dropped
+        // under compression where it would make the matrix indefinite
+        const double transverse = std::max(1.0 - joint.restLength / length, 0.0);
+        double h[9];            // dt c nn' + dt^2 K, added to aa and bb and taken from ab and ba
+        double kv[3] = {};      // K (va - vb)
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                double nn = n[r] * n[c];
+                double k = joint.stiffness * (nn + transverse * ((r == c ? 1.0 : 0.0) - nn));
+                h[r * 3 + c] = dt * joint.damping * nn + dt * dt * k;
+                kv[r] += k * relative[c];
+            }
+        }
+
+        const int a = mBlock[joint.a];
+        const int b = mBlock[joint.b];
+        const int* slots = &mJointSlots[j * 36];
+        for (int e = 0; e < 9; ++e) {
+            if (!mFixed[a]) values[slots[e]] += h[e];
+            if (!mFixed[b]) values[slots[9 + e]] += h[e];
+            if (!mFixed[a] && !mFixed[b]) {
+                values[slots[18 + e]] -= h[e];
+                values[slots[27 + e]] -= h[e];
+            }
+        }
+
+        // dt (f + dt df/dx v), df_a/dx_a = -K
+        for (int axis = 0; axis < 3; ++axis) {
+            double impulse = dt * (magnitude * n[axis] - dt * kv[axis]);
+            if (!mFixed[a]) mRhs[a * 3 + axis] += impulse;
+            if (!mFixed[b]) mRhs[b * 3 + axis] -= impulse;
+        }
+    }
+
+    mSolver.factorize(mMatrix);
+    if (mSolver.info() != Eigen::Success) {
+        mStats.failed = true;
+        return;
+    }
+    mDeltaV = mSolver.solve(mRhs);
+
+    for (size_t body = 0; body < mBodies.size(); ++body) {
+        glm::vec3& velocity = components.physics[mBodies[body]].velocity;
+        velocity.x += static_cast<float>(mDeltaV[body * 3]);
+        velocity.y += static_cast<float>(mDeltaV[body * 3 + 1]);
+        velocity.z += static_cast<float>(mDeltaV[body * 3 + 2]);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <Eigen/SparseCore>
+#include <Eigen/SparseCholesky>
+#include "ComponentManager.h"
+
+// Joints and work of the last solve
+struct JointStats {
+    size_t joints = 0;
+    size_t bodies = 0;          // Entities with at least one joint
+    bool analyzed = false;      // Joint graph changed, the symbolic analysis was redone
+    bool failed = false;        // Factorization failed, the springs were skipped
+};
+
+// Backward Euler for the spring joints: one linearized implicit step over the joint graph,
+//   (M + dt C + dt^2 K) dv = dt (f + dt K' v)
+// assembled into a sparse matrix and factored with LDLT. The sparsity pattern depends only
+// on which entities are joined, so the symbolic analysis is kept until the graph changes
+// and each step only refactors the values. Stiff springs stay stable at a 16 ms step.
+class JointSolver {
+public:
+    JointSolver() = default;
+
+    // The Eigen factorization can't be copied; copies rebuild it on their first solve
+    JointSolver(const JointSolver&) {}
+    JointSolver& operator=(const JointSolver&) {
+        mPatternEnds.clear();
+        mPatternEntities = 0;
+        return *this;
+    }
+
+    // Adds the springs' velocity change over deltaTime to the joined entities
+    void solve(ComponentArrays& components, float deltaTime);
+
+    const JointStats& getStats() const { return mStats; }
+
+private:
+    // Maps the joined entities to matrix blocks and sets up the pattern and value slots
+    void analyze(const ComponentArrays& components);
+
+    // Offset of (row, col) in the matrix values, the entry must exist in the pattern
+    int slot(int row, int col) { return static_cast<int>(&mMatrix.coeffRef(row, col) - mMatrix.valuePtr()); }
+
+    JointStats mStats;
+
+    // Joint graph the pattern was built for
+    std::vector<uint32_t> mPatternEnds;
+    size_t mPatternEntities = 0;
+
+    std::vector<int> mBlock;            // Per entity, matrix block or -1
+    std::vector<uint32_t> mBodies;      // Entity of each block
+    std::vector<int> mDiagonalSlots;    // 9 per body
+    std::vector<int> mJointSlots;       // 4 blocks of 9 per joint: aa, bb, ab, ba
+    std::vector<uint8_t> mFixed;        // Per body, massless so the springs leave it alone
+
+    Eigen::SparseMatrix<double> mMatrix;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> mSolver;
+    Eigen::VectorXd mRhs;
+    Eigen::VectorXd mDeltaV;
+};
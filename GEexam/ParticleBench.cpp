@@ -0,0 +1,110 @@
+// Particle throughput benchmark. Drives ParticleSystem with the GL calls stubbed out
+// and prints CSV, one row per (particles, kernel, threads):
+//
+//   ParticleBench [maxParticles] [minParticles]
+//
+// update_ns, spawn_ns and upload_ns are CPU time per particle of each phase (summed over
+// threads), frame_ns is wall time per alive particle for the whole update.
+#include "ParticleSystem.h"
+#include "GLRecorder.h"
+#include "ThreadPool.h"
+#include "Simd.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+// Particle updates measured per configuration, enough to average out timer noise
+const double UPDATES_PER_RUN = 2.0e7;
+const int MIN_FRAMES = 5;
+const int MAX_FRAMES = 500;
+const float FRAME_TIME = 0.016f;
+
+// Short lives keep the pool churning, so every frame respawns a few percent of it
+const float CHURN_LIFETIME = 0.25f;
+
+struct BenchResult {
+    double updateNs = 0.0;
+    double spawnNs = 0.0;
+    double uploadNs = 0.0;
+    double frameNs = 0.0;
+    size_t alive = 0;
+    int frames = 0;
+};
+
+static double perParticle(double ms, size_t count) {
+    return count > 0 ? ms * 1.0e6 / count : 0.0;
+}
+
+static BenchResult runBench(int particles, bool vectorized, ThreadPool* pool) {
+    ParticleSystem system(particles, glm::vec3(-25.0f, -5.0f, -25.0f), glm::vec3(25.0f, 5.0f, 25.0f));
+    system.setVectorized(vectorized);
+    system.setThreadPool(pool);
+
+    EmitterSettings emitter = system.getEmitter();
+    emitter.lifetime = CHURN_LIFETIME;
+    emitter.rate = particles / CHURN_LIFETIME;
+    system.setEmitter(emitter);
+
+    // The constructor's burst dies in one wave, after two lifetimes deaths and spawns
+    // are spread evenly over the frames
+    const int warmupFrames = static_cast<int>(2.0f * CHURN_LIFETIME / FRAME_TIME) + 1;
+    for (int frame = 0; frame < warmupFrames; ++frame) {
+        system.update(FRAME_TIME);
+    }
+
+    BenchResult result;
+    result.frames = static_cast<int>(std::min(std::max(UPDATES_PER_RUN / particles, double(MIN_FRAMES)), double(MAX_FRAMES)));
+
+    double updateMs = 0.0, spawnMs = 0.0, uploadMs = 0.0, frameMs = 0.0;
+    size_t updated = 0, spawned = 0, uploaded = 0;
+    for (int frame = 0; frame < result.frames; ++frame) {
+        auto start = std::chrono::steady_clock::now();
+        system.update(FRAME_TIME);
+        frameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        const ParticleUpdateTimings& timings = system.getLastTimings();
+        updateMs += timings.updateMs;
+        spawnMs += timings.spawnMs;
+        uploadMs += timings.uploadMs;
+        updated += timings.updated;
+        spawned += timings.spawned;
+        uploaded += timings.uploaded;
+    }
+
+    result.updateNs = perParticle(updateMs, updated);
+    result.spawnNs = perParticle(spawnMs, spawned);
+    result.uploadNs = perParticle(uploadMs, uploaded);
+    result.frameNs = perParticle(frameMs, uploaded);
+    result.alive = static_cast<size_t>(system.getAliveCount());
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int maxParticles = argc > 1 ? std::atoi(argv[1]) : 10000000;
+    int minParticles = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+    // No context: buffer maps fail, so uploads go through the staging copy
+    GLRecorder::install(GLRecorder::Mode::Null);
+
+    ThreadPool& pool = ThreadPool::shared();
+    std::fprintf(stderr, "simd width %d, %zu worker threads + caller\n", SimdFloat::WIDTH, pool.getWorkerCount());
+
+    std::printf("particles,kernel,threads,frames,alive,update_ns,spawn_ns,upload_ns,frame_ns\n");
+    for (int particles = minParticles; particles > 0 && particles <= maxParticles; particles *= 10) {
+        for (int kernel = 0; kernel < 2; ++kernel) {
+            bool vectorized = kernel == 1;
+            // Without workers the threaded run would repeat the single-threaded one
+            for (int threaded = 0; threaded < (pool.getWorkerCount() > 0 ? 2 : 1); ++threaded) {
+                ThreadPool* runPool = threaded ? &pool : nullptr;
+                size_t threads = threaded ? pool.getWorkerCount() + 1 : 1;
+
+                BenchResult result = runBench(particles, vectorized, runPool);
+                std::printf("%d,%s,%zu,%d,%zu,%.3f,%.3f,%.3f,%.3f\n", particles, vectorized ? "simd" : "scalar",
+                    threads, result.frames, result.alive, result.updateNs, result.spawnNs, result.uploadNs, result.frameNs);
+                std::fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
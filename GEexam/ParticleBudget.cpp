@@ -0,0 +1,93 @@
+#include "ParticleBudget.h"
+#include <algorithm>
+
+void ParticleBudget::allocate(const std::vector<ParticleBudgetRequest>& requests, const glm::vec3& cameraPosition,
+    std::vector<size_t>& limits) {
+    const size_t count = requests.size();
+    limits.assign(count, 0);
+    mWeights.resize(count);
+    mOpen.clear();
+
+    // Higher priority and nearer emitters weigh more
+    const float referenceDistance = std::max(mSettings.referenceDistance, 1e-3f);
+    for (size_t i = 0; i < count; ++i) {
+        float distance = mDeterministic ? 0.0f : glm::length(requests[i].position - cameraPosition);
+        mWeights[i] = std::max(requests[i].priority, 0.0f) / (1.0f + distance / referenceDistance);
+        if (mWeights[i] > 0.0f && requests[i].capacity > 0) {
+            mOpen.push_back(i);
+        }
+    }
+
+    const size_t scaledMax = mDeterministic ? mSettings.maxParticles : static_cast<size_t>(mSettings.maxParticles * mScale);
+    size_t remaining = scaledMax;
+
+    // Split by weight; emitters whose share exceeds their capacity are capped and the
+    // rest re-split what they leave, until every share fits
+    while (!mOpen.empty()) {
+        double totalWeight = 0.0;
+        for (size_t i : mOpen) {
+            totalWeight += mWeights[i];
+        }
+
+        size_t cappedParticles = 0;
+        size_t kept = 0;
+        for (size_t i : mOpen) {
+            double share = remaining * (mWeights[i] / totalWeight);
+            if (share >= static_cast<double>(requests[i].capacity)) {
+                limits[i] = requests[i].capacity;
+                cappedParticles += requests[i].capacity;
+            }
+            else {
+                mOpen[kept++] = i;
+            }
+        }
+
+        if (kept == mOpen.size()) {
+            for (size_t i : mOpen) {
+                limits[i] = static_cast<size_t>(remaining * (mWeights[i] / totalWeight));
+            }
+            break;
+        }
+        mOpen.resize(kept);
+        remaining -= cappedParticles;
+    }
+
+    mStats.maxParticles = mSettings.maxParticles;
+    mStats.scaledMaxParticles = scaledMax;
+    mStats.allocated = 0;
+    for (size_t limit : limits) {
+        mStats.allocated += limit;
+    }
+}
+
+void ParticleBudget::reportFrame(float updateMs, size_t alive) {
+    // Averaged so a single slow frame doesn't cut the budget
+    mSmoothedMs = mSmoothedMs < 0.0f ? updateMs : mSmoothedMs + (updateMs - mSmoothedMs) * 0.2f;
+
+    const float target = mSettings.targetUpdateMs;
+    if (mSmoothedMs > target) {
+        // Over: shrink towards the scale that would hit the target, a few percent a frame
+        // since the average lags behind
+        mScale *= std::max(target / mSmoothedMs, 0.95f);
+    }
+    else if (mSmoothedMs < target * 0.8f) {
+        // Comfortably under: grow back slowly. The band in between keeps the scale from
+        // oscillating around the target.
+        mScale *= 1.02f;
+    }
+    mScale = std::min(std::max(mScale, mSettings.minScale), 1.0f);
+
+    mStats.alive = alive;
+    mStats.updateMs = updateMs;
+    mStats.smoothedUpdateMs = mSmoothedMs;
+    mStats.targetUpdateMs = target;
+    mStats.scale = mScale;
+}
+
+void ParticleBudget::hashState(StateHash& hash) const {
+    // Deterministic budgets ignore the measured times, which differ from run to run
+    hash.add(static_cast<uint64_t>(mDeterministic));
+    if (mDeterministic) return;
+    hash.add(&mScale, sizeof(mScale));
+    hash.add(&mSmoothedMs, sizeof(mSmoothedMs));
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "StateHash.h"
+
+struct ParticleBudgetSettings {
+    size_t maxParticles = 20000;        // Global cap shared by every emitter
+    float targetUpdateMs = 1.0f;        // Particle update time the budget steers towards
+    float referenceDistance = 50.0f;    // Camera distance at which an emitter's weight halves
+    float minScale = 0.1f;              // Lowest fraction of the cap the budget shrinks to
+};
+
+// One emitter asking for particles
+struct ParticleBudgetRequest {
+    float priority = 1.0f;
+    glm::vec3 position{ 0.0f };
+    size_t capacity = 0;                // Particles the emitter has storage for
+};
+
+// Budget usage from the last frame
+struct ParticleBudgetStats {
+    size_t maxParticles = 0;
+    size_t scaledMaxParticles = 0;      // Cap after the time-based scale
+    size_t allocated = 0;               // Sum of the emitter limits
+    size_t alive = 0;
+    float updateMs = 0.0f;              // Measured particle update time
+    float smoothedUpdateMs = 0.0f;
+    float targetUpdateMs = 0.0f;
+    float scale = 1.0f;
+
+    float usage() const { return maxParticles > 0 ? static_cast<float>(alive) / maxParticles : 0.0f; }
+};
+
+// Splits a global particle cap among emitters by priority and camera distance, and
+// scales the cap with the measured update time so particle cost stays near a target.
+class ParticleBudget {
+public:
+    // Time feedback carried from frame to frame, for snapshots
+    struct State {
+        float scale = 1.0f;
+        float smoothedMs = -1.0f;
+    };
+
+    void setSettings(const ParticleBudgetSettings& settings) { mSettings = settings; }
+    const ParticleBudgetSettings& getSettings() const { return mSettings; }
+
+    // Splits by priority alone and keeps the full cap, so limits depend on neither the
+    // camera nor measured time
+    void setDeterministic(bool deterministic) { mDeterministic = deterministic; }
+
+    // Writes each emitter's particle limit, never above its capacity
+    void allocate(const std::vector<ParticleBudgetRequest>& requests, const glm::vec3& cameraPosition,
+        std::vector<size_t>& limits);
+
+    // Feeds back the last frame's particle update time, adjusting the scale for the next
+    void reportFrame(float updateMs, size_t alive);
+
+    const ParticleBudgetStats& getStats() const { return mStats; }
+
+    // Adds the time feedback (scale and smoothed update time) to hash, unless deterministic
+    void hashState(StateHash& hash) const;
+
+    void saveState(State& state) const { state = { mScale, mSmoothedMs }; }
+    void restoreState(const State& state) {
+        mScale = state.scale;
+        mSmoothedMs = state.smoothedMs;
+    }
+
+private:
+    ParticleBudgetSettings mSettings;
+    ParticleBudgetStats mStats;
+    float mScale = 1.0f;
+    bool mDeterministic = false;
+    float mSmoothedMs = -1.0f;
+
+    std::vector<float> mWeights;
+    std::vector<size_t> mOpen;
+};
@@ -0,0 +1,162 @@
+#include "ParticleEffect.h"
+#include "Simd.h"
+
+Affector Affector::gravity(const glm::vec3& acceleration) {
+    Affector affector;
+    affector.type = Type::Gravity;
+    affector.vector = acceleration;
+    return affector;
+}
+
+Affector Affector::drag(float coefficient) {
+    Affector affector;
+    affector.type = Type::Drag;
+    affector.strength = coefficient;
+    return affector;
+}
+
+Affector Affector::wind(const glm::vec3& velocity, float strength) {
+    Affector affector;
+    affector.type = Type::Wind;
+    affector.vector = velocity;
+    affector.strength = strength;
+    return affector;
+}
+
+Affector Affector::vortex(const glm::vec3& center, const glm::vec3& axis, float strength) {
+    Affector affector;
+    affector.type = Type::Vortex;
+    affector.vector = axis;
+    affector.point = center;
+    affector.strength = strength;
+    return affector;
+}
+
+Affector Affector::colorOverLife(const glm::vec3& startColor, const glm::vec3& endColor) {
+    Affector affector;
+    affector.type = Type::ColorOverLife;
+    affector.vector = startColor;
+    affector.point = endColor;
+    return affector;
+}
+
+// One pass over the streams for every affector: velocity, position and lifetime are
+// each loaded and stored once. Forces and Vortex drop the terms that are zero.
+template <typename Lanes, bool Forces, bool Vortex>
+static size_t integrateFused(const CompiledEffect& effect, const ParticleStreams& streams,
+    size_t begin, size_t end, float deltaTime, float floorY, uint32_t* dead) {
+    const Lanes dt = Lanes::set(deltaTime);
+    const Lanes floor = Lanes::set(floorY);
+    const Lanes zero = Lanes::set(0.0f);
+    const Lanes one = Lanes::set(1.0f);
+
+    // Implicit step for the linear part: v' = (v + a dt) / (1 + damping dt), stable for any dt
+    const Lanes ax = Lanes::set(effect.acceleration.x * deltaTime);
+    const Lanes ay = Lanes::set(effect.acceleration.y * deltaTime);
+    const Lanes az = Lanes::set(effect.acceleration.z * deltaTime);
+    const Lanes damping = Lanes::set(1.0f / (1.0f + effect.damping * deltaTime));
+
+    size_t deadCount = 0;
+    for (size_t i = begin; i < end; i += Lanes::WIDTH) {
+        Lanes px = Lanes::load(streams.posX + i);
+        Lanes py = Lanes::load(streams.posY + i);
+        Lanes pz = Lanes::load(streams.posZ + i);
+        Lanes vx = Lanes::load(streams.velX + i);
+        Lanes vy = Lanes::load(streams.velY + i);
+        Lanes vz = Lanes::load(streams.velZ + i);
+
+        if (Vortex) {
+            // Tangential push cross(axis, d), weakened by the squared distance from the axis
+            for (int v = 0; v < effect.vortexCount; ++v) {
+                const glm::vec3& axis = effect.vortexAxis[v];
+                Lanes dx = px - Lanes::set(effect.vortexCenter[v].x);
+                Lanes dy = py - Lanes::set(effect.vortexCenter[v].y);
+                Lanes dz = pz - Lanes::set(effect.vortexCenter[v].z);
+                Lanes along = dx * Lanes::set(axis.x) + dy * Lanes::set(axis.y) + dz * Lanes::set(axis.z);
+                Lanes radialSq = dx * dx + dy * dy + dz * dz - along * along;
+                Lanes scale = Lanes::set(effect.vortexStrength[v] * deltaTime) / (radialSq + one);
+                vx = vx + (Lanes::set(axis.y) * dz - Lanes::set(axis.z) * dy) * scale;
+                vy = vy + (Lanes::set(axis.z) * dx - Lanes::set(axis.x) * dz) * scale;
+                vz = vz + (Lanes::set(axis.x) * dy - Lanes::set(axis.y) * dx) * scale;
+            }
+        }
+        if (Forces) {
+            vx = (vx + ax) * damping;
+            vy = (vy + ay) * damping;
+            vz = (vz + az) * damping;
+        }
+        if (Forces || Vortex) {
+            vx.store(streams.velX + i);
+            vy.store(streams.velY + i);
+            vz.store(streams.velZ + i);
+        }
+
+        py = py + vy * dt;
+        Lanes life = Lanes::load(streams.life + i) - dt;
+        (px + vx * dt).store(streams.posX + i);
+        py.store(streams.posY + i);
+        (pz + vz * dt).store(streams.posZ + i);
+        life.store(streams.life + i);
+
+        int hits = (lessEqual(py, floor) | lessEqual(life, zero)).mask();
+        while (hits) {
+            int lane = 0;
+            while (!(hits & (1 << lane))) ++lane;
+            if (i + lane < end) dead[deadCount++] = static_cast<uint32_t>(i + lane);
+            hits &= hits - 1;
+        }
+    }
+    return deadCount;
+}
+
+template <typename Lanes>
+static ParticleKernel selectFused(bool forces, bool vortex) {
+    if (forces && vortex) return &integrateFused<Lanes, true, true>;
+    if (forces) return &integrateFused<Lanes, true, false>;
+    if (vortex) return &integrateFused<Lanes, false, true>;
+    return &integrateFused<Lanes, false, false>;
+}
+
+void CompiledEffect::selectKernel(bool vectorized) {
+    bool forces = acceleration != glm::vec3(0.0f) || damping != 0.0f;
+    bool vortex = vortexCount > 0;
+    integrate = vectorized ? selectFused<SimdFloat>(forces, vortex) : selectFused<ScalarFloat>(forces, vortex);
+}
+
+CompiledEffect ParticleEffect::compile() const {
+    CompiledEffect compiled;
+
+    // Wind k_i (w_i - v) and drag d_i (-v) sum to (sum k_i w_i) - (sum k_i + sum d_i) v
+    glm::vec3 windPull(0.0f);
+    for (const Affector& affector : affectors) {
+        switch (affector.type) {
+        case Affector::Type::Gravity:
+            compiled.acceleration += affector.vector;
+            break;
+        case Affector::Type::Drag:
+            compiled.damping += affector.strength;
+            break;
+        case Affector::Type::Wind:
+            windPull += affector.vector * affector.strength;
+            compiled.damping += affector.strength;
+            break;
+        case Affector::Type::Vortex:
+            if (compiled.vortexCount < CompiledEffect::MAX_VORTICES && glm::length(affector.vector) > 0.0f) {
+                int v = compiled.vortexCount++;
+                compiled.vortexCenter[v] = affector.point;
+                compiled.vortexAxis[v] = glm::normalize(affector.vector);
+                compiled.vortexStrength[v] = affector.strength;
+            }
+            break;
+        case Affector::Type::ColorOverLife:
+            compiled.colorOverLife = true;
+            compiled.startColor = affector.vector;
+            compiled.endColor = affector.point;
+            break;
+        }
+    }
+    compiled.acceleration += windPull;
+
+    compiled.selectKernel(true);
+    return compiled;
+}
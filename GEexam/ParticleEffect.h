@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// How an emitter spawns particles
+struct EmitterSettings {
+    float rate = 200.0f;        // Particles per second
+    float lifetime = 10.0f;     // Seconds, particles also die when they reach the floor
+    glm::vec3 velocityMin{ 0.0f, -3.0f, 0.0f };   // Spawn velocity, random per axis
+    glm::vec3 velocityMax{ 0.0f, -1.0f, 0.0f };
+};
+
+// One behaviour applied to every particle of an emitter
+struct Affector {
+    enum class Type {
+        Gravity,        // Constant acceleration: vector
+        Drag,           // Linear drag: strength per second
+        Wind,           // Pulls velocity towards vector at strength per second
+        Vortex,         // Swirl around the axis vector through point, strength falls off with distance
+        ColorOverLife   // Blends from vector to point (RGB) over the particle's lifetime
+    };
+
+    Type type = Type::Gravity;
+    glm::vec3 vector{ 0.0f };
+    glm::vec3 point{ 0.0f };
+    float strength = 0.0f;
+
+    static Affector gravity(const glm::vec3& acceleration);
+    static Affector drag(float coefficient);
+    static Affector wind(const glm::vec3& velocity, float strength);
+    static Affector vortex(const glm::vec3& center, const glm::vec3& axis, float strength);
+    static Affector colorOverLife(const glm::vec3& startColor, const glm::vec3& endColor);
+};
+
+// Particle streams one kernel works on
+struct ParticleStreams {
+    float* posX;
+    float* posY;
+    float* posZ;
+    float* velX;
+    float* velY;
+    float* velZ;
+    float* life;
+};
+
+struct CompiledEffect;
+using ParticleKernel = size_t(*)(const CompiledEffect& effect, const ParticleStreams& streams,
+    size_t begin, size_t end, float deltaTime, float floorY, uint32_t* dead);
+
+// An affector stack folded into one pass. Gravity, wind and drag are all linear in the
+// velocity, so any number of them collapses into dv/dt = acceleration - damping * v.
+struct CompiledEffect {
+    static constexpr int MAX_VORTICES = 4;
+
+    glm::vec3 acceleration{ 0.0f };
+    float damping = 0.0f;
+
+    int vortexCount = 0;
+    glm::vec3 vortexCenter[MAX_VORTICES];
+    glm::vec3 vortexAxis[MAX_VORTICES];     // Normalized
+    float vortexStrength[MAX_VORTICES] = {};
+
+    bool colorOverLife = false;
+    glm::vec3 startColor{ 1.0f };
+    glm::vec3 endColor{ 1.0f };
+
+    // Kernel specialized for the terms above: integrate, count lifetimes down and
+    // collect particles that expired or reached floorY
+    ParticleKernel integrate = nullptr;
+
+    // Picks integrate for the terms above; one float at a time when vectorized is false
+    void selectKernel(bool vectorized);
+};
+
+struct ParticleEffect {
+    EmitterSettings emitter;
+    std::vector<Affector> affectors;
+
+    CompiledEffect compile() const;
+};
@@ -1,86 +1,612 @@
 #include "ParticleSystem.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
 
-ParticleSystem::ParticleSystem(int maxParticles, const glm::vec3& boxMin, const glm::vec3& boxMax)
-    : mMaxParticles(maxParticles), mBoxMin(boxMin), mBoxMax(boxMax) {
-    // Seed random number generator
-    std::srand(static_cast<unsigned>(std::time(0)));
+static uint64_t sNextEmitterStream = 0;
 
-    // Initialize particle data
-    mPositions.resize(maxParticles);
-    mVelocities.resize(maxParticles);
-    mLifetimes.resize(maxParticles);
-    mActive.resize(maxParticles, true);
+ParticleSystem::ParticleSystem(int maxParticles, const glm::vec3& boxMin, const glm::vec3& boxMax, uint64_t seed,
+    uint64_t stream)
+    : mMaxParticles(maxParticles), mBoxMin(boxMin), mBoxMax(boxMax) {
+    // Initialize particle data, padded so the kernel never needs a tail loop
+    size_t capacity = ((maxParticles + PARTICLE_BLOCK - 1) / PARTICLE_BLOCK) * PARTICLE_BLOCK;
+    mPosX.resize(capacity, 0.0f);
+    mPosY.resize(capacity, 0.0f);
+    mPosZ.resize(capacity, 0.0f);
+    mVelX.resize(capacity, 0.0f);
+    mVelY.resize(capacity, 0.0f);
+    mVelZ.resize(capacity, 0.0f);
+    mLifetimes.resize(capacity, 0.0f);
+    mSpawnLifetimes.resize(capacity, 0.0f);
+    mDead.resize(capacity);
 
-    for (int i = 0; i < maxParticles; ++i) {
-        respawnParticle(i);
+    size_t blockCount = (capacity + UPDATE_BLOCK - 1) / UPDATE_BLOCK;
+    uint64_t emitterStream = stream == AUTO_STREAM ? sNextEmitterStream++ : stream;
+    mBlockDeadCount.resize(blockCount, 0);
+    mBlockTimings.resize(blockCount);
+    mBlockCollision.resize(blockCount);
+    for (size_t block = 0; block < blockCount; ++block) {
+        mBlockRandom.emplace_back(seed, (emitterStream << 20) | block);
     }
 
-    // OpenGL setup for particle rendering
+    mEffect = ParticleEffect().compile();
+    mParticleLimit = maxParticles;
+    mThreadPool = &ThreadPool::shared();
+
+    // Start full, then replace roughly the whole pool every five seconds
+    mEmitter.rate = maxParticles / 5.0f;
+    burst(maxParticles);
+}
+
+void ParticleSystem::createBuffers() {
     glGenVertexArrays(1, &mVAO);
-    glGenBuffers(1, &mVBO);
+    // Room for the widest vertex (float position + colour), and a multiple of every
+    // stride so each region starts on a whole vertex
+    size_t regionSize = mMaxParticles * 16;
+    mStream.create(((regionSize + 47) / 48) * 48);
+
+    bindVertexFormat(mEffect.colorOverLife);
+}
+
+void ParticleSystem::setFormat(ParticleFormat format) {
+    if (format == mFormat) return;
+    mFormat = format;
+    if (mVAO != 0) {
+        bindVertexFormat(mBoundColorOverLife);
+    }
+}
+
+void ParticleSystem::setEffect(const ParticleEffect& effect) {
+    mEmitter = effect.emitter;
+    mEffect = effect.compile();
+    mEffect.selectKernel(mVectorized);
+}
+
+void ParticleSystem::setDeferredUpload(bool deferred) {
+    mDeferredUpload = deferred;
+    if (deferred) {
+        mDeferredVertices.resize(static_cast<size_t>(mMaxParticles) * 16);
+    }
+    else {
+        mDeferredVertices.clear();
+        mDeferredVertices.shrink_to_fit();
+    }
+    // Neither the stream nor the CPU copy holds this update's vertices
+    mDrawCount = 0;
+}
+
+size_t ParticleSystem::getVertexStride(bool colorOverLife) const {
+    return colorOverLife ? getColorOffset() + 4 : getPositionStride();
+}
+
+size_t ParticleSystem::getPositionStride() const {
+    switch (mFormat) {
+    case ParticleFormat::Unorm16:       return 3 * sizeof(uint16_t);
+    case ParticleFormat::Packed1010102: return sizeof(uint32_t);
+    default:                            return sizeof(glm::vec3);
+    }
+}
 
+void ParticleSystem::bindVertexFormat(bool colorOverLife) {
+    mBoundColorOverLife = colorOverLife;
     glBindVertexArray(mVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glBufferData(GL_ARRAY_BUFFER, mPositions.size() * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, mStream.getBuffer());
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    // Normalized formats arrive in the shader as 0..1 per axis
+    const GLsizei stride = static_cast<GLsizei>(getVertexStride(colorOverLife));
+    switch (mFormat) {
+    case ParticleFormat::Unorm16:
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+        break;
+    case ParticleFormat::Packed1010102:
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)0);
+        break;
+    default:
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        break;
+    }
     glEnableVertexAttribArray(0);
 
+    // Colour over life: location 9, the same slot instanced draws use for their colour
+    if (colorOverLife) {
+        glVertexAttribPointer(9, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)getColorOffset());
+        glEnableVertexAttribArray(9);
+    }
+    else {
+        glDisableVertexAttribArray(9);
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
 
-void ParticleSystem::update(float deltaTime) {
-    for (int i = 0; i < mMaxParticles; ++i) {
-        if (!mActive[i]) continue;
+void ParticleSystem::writeVertices(void* upload, size_t begin, size_t end) const {
+    unsigned char* bytes = static_cast<unsigned char*>(upload);
+    const size_t stride = getVertexStride();
 
-        // Update position
-        mPositions[i] += mVelocities[i] * deltaTime;
+    if (mFormat == ParticleFormat::Float) {
+        for (size_t i = begin; i < end; ++i) {
+            float* out = reinterpret_cast<float*>(bytes + i * stride);
+            out[0] = mPosX[i];
+            out[1] = mPosY[i];
+            out[2] = mPosZ[i];
+        }
+    }
+    else {
+        // cullOutOfBounds() killed everything outside the bounds, the clamp only catches rounding
+        const float maxValue = mFormat == ParticleFormat::Unorm16 ? 65535.0f : 1023.0f;
+        const glm::vec3 scale = maxValue / mQuantExtent;
+        auto quantize = [maxValue](float value, float min, float scale) {
+            return static_cast<uint32_t>(std::min(std::max((value - min) * scale, 0.0f), maxValue) + 0.5f);
+        };
 
-        // Check if the particle has reached the floor of the box
-        if (mPositions[i].y <= mBoxMin.y) {
-            respawnParticle(i);
+        if (mFormat == ParticleFormat::Unorm16) {
+            for (size_t i = begin; i < end; ++i) {
+                uint16_t* out = reinterpret_cast<uint16_t*>(bytes + i * stride);
+                out[0] = static_cast<uint16_t>(quantize(mPosX[i], mQuantMin.x, scale.x));
+                out[1] = static_cast<uint16_t>(quantize(mPosY[i], mQuantMin.y, scale.y));
+                out[2] = static_cast<uint16_t>(quantize(mPosZ[i], mQuantMin.z, scale.z));
+            }
+        }
+        else {
+            for (size_t i = begin; i < end; ++i) {
+                *reinterpret_cast<uint32_t*>(bytes + i * stride) = quantize(mPosX[i], mQuantMin.x, scale.x) |
+                    (quantize(mPosY[i], mQuantMin.y, scale.y) << 10) |
+                    (quantize(mPosZ[i], mQuantMin.z, scale.z) << 20);
+            }
         }
     }
 
-    // Update OpenGL buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, mPositions.size() * sizeof(glm::vec3), mPositions.data());
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (mEffect.colorOverLife) {
+        // Age 0..1 from the remaining share of the spawn lifetime, blended and packed as RGBA8
+        const size_t colorOffset = getColorOffset();
+        const glm::vec3 start = glm::clamp(mEffect.startColor, 0.0f, 1.0f) * 255.0f;
+        const glm::vec3 delta = glm::clamp(mEffect.endColor, 0.0f, 1.0f) * 255.0f - start;
+        for (size_t i = begin; i < end; ++i) {
+            float remaining = mSpawnLifetimes[i] > 0.0f ? mLifetimes[i] / mSpawnLifetimes[i] : 0.0f;
+            float age = std::min(std::max(1.0f - remaining, 0.0f), 1.0f);
+            glm::vec3 color = start + delta * age + 0.5f;
+            *reinterpret_cast<uint32_t*>(bytes + i * stride + colorOffset) =
+                static_cast<uint32_t>(color.r) | (static_cast<uint32_t>(color.g) << 8) |
+                (static_cast<uint32_t>(color.b) << 16) | 0xFF000000u;
+        }
+    }
 }
 
-void ParticleSystem::render(Shader& shader, const glm::mat4& view, const glm::mat4& projection) {
-    shader.use();
+void ParticleSystem::setVectorized(bool vectorized) {
+    mVectorized = vectorized;
+    mEffect.selectKernel(vectorized);
+}
 
-    shader.setMat4("view", view);
-    shader.setMat4("projection", projection);
-    shader.setVec3("objectColor", glm::vec3(0.0f, 0.5f, 1.0f)); 
-    shader.setBool("useFlatColor", true);
+// Hashed as raw bytes, the generator is nothing but its state words
+static_assert(sizeof(Random) % sizeof(uint64_t) == 0, "Random has padding");
 
-    glPointSize(2.0f);
-    glBindVertexArray(mVAO);
-    glDrawArrays(GL_POINTS, 0, mMaxParticles);
-    glBindVertexArray(0);
+void ParticleSystem::hashState(StateHash& hash) const {
+    hash.add(static_cast<uint64_t>(mAliveCount));
+    hash.add(&mEmitAccumulator, sizeof(mEmitAccumulator));
+    hash.add(static_cast<uint64_t>(static_cast<int64_t>(mPendingBurst)));
+    hash.add(static_cast<uint64_t>(mParticleLimit));
+    hash.add(&mRateScale, sizeof(mRateScale));
+    hash.addArray(mBlockRandom, mBlockRandom.size());
+    hash.addArray(mPosX, mAliveCount);
+    hash.addArray(mPosY, mAliveCount);
+    hash.addArray(mPosZ, mAliveCount);
+    hash.addArray(mVelX, mAliveCount);
+    hash.addArray(mVelY, mAliveCount);
+    hash.addArray(mVelZ, mAliveCount);
+    hash.addArray(mLifetimes, mAliveCount);
+    hash.addArray(mSpawnLifetimes, mAliveCount);
+}
+
+void ParticleSystem::saveState(Snapshot& snapshot) const {
+    snapshot.posX.assign(mPosX.begin(), mPosX.begin() + mAliveCount);
+    snapshot.posY.assign(mPosY.begin(), mPosY.begin() + mAliveCount);
+    snapshot.posZ.assign(mPosZ.begin(), mPosZ.begin() + mAliveCount);
+    snapshot.velX.assign(mVelX.begin(), mVelX.begin() + mAliveCount);
+    snapshot.velY.assign(mVelY.begin(), mVelY.begin() + mAliveCount);
+    snapshot.velZ.assign(mVelZ.begin(), mVelZ.begin() + mAliveCount);
+    snapshot.lifetimes.assign(mLifetimes.begin(), mLifetimes.begin() + mAliveCount);
+    snapshot.spawnLifetimes.assign(mSpawnLifetimes.begin(), mSpawnLifetimes.begin() + mAliveCount);
+    snapshot.blockRandom = mBlockRandom;
+    snapshot.aliveCount = mAliveCount;
+    snapshot.emitAccumulator = mEmitAccumulator;
+    snapshot.pendingBurst = mPendingBurst;
+    snapshot.particleLimit = mParticleLimit;
+    snapshot.rateScale = mRateScale;
+}
 
-    shader.setBool("useFlatColor", false);
+void ParticleSystem::restoreState(const Snapshot& snapshot) {
+    const size_t count = snapshot.aliveCount;
+    std::copy_n(snapshot.posX.begin(), count, mPosX.begin());
+    std::copy_n(snapshot.posY.begin(), count, mPosY.begin());
+    std::copy_n(snapshot.posZ.begin(), count, mPosZ.begin());
+    std::copy_n(snapshot.velX.begin(), count, mVelX.begin());
+    std::copy_n(snapshot.velY.begin(), count, mVelY.begin());
+    std::copy_n(snapshot.velZ.begin(), count, mVelZ.begin());
+    std::copy_n(snapshot.lifetimes.begin(), count, mLifetimes.begin());
+    std::copy_n(snapshot.spawnLifetimes.begin(), count, mSpawnLifetimes.begin());
+    mBlockRandom = snapshot.blockRandom;
+    mAliveCount = count;
+    mEmitAccumulator = snapshot.emitAccumulator;
+    mPendingBurst = snapshot.pendingBurst;
+    mParticleLimit = snapshot.particleLimit;
+    mRateScale = snapshot.rateScale;
 }
 
-void ParticleSystem::respawnParticle(int index) {
-    // Random x and z within the box bounds
-    float x = mBoxMin.x + static_cast<float>(std::rand()) / RAND_MAX * (mBoxMax.x - mBoxMin.x);
-    float z = mBoxMin.z + static_cast<float>(std::rand()) / RAND_MAX * (mBoxMax.z - mBoxMin.z);
+void ParticleSystem::setBudget(size_t limit, float rateScale) {
+    mParticleLimit = std::min(limit, static_cast<size_t>(mMaxParticles));
+    mRateScale = rateScale;
+}
 
-    // Spawn at random height slightly above the box
-    float y = mBoxMax.y + static_cast<float>(std::rand()) / RAND_MAX * 2.0f;
+void ParticleSystem::update(float deltaTime, const SpatialGrid* colliders) {
+    auto start = std::chrono::steady_clock::now();
 
-    // Random downward velocity
-    float velocityY = -1.0f - static_cast<float>(std::rand()) / RAND_MAX * 2.0f;
+    // A shrunk budget takes effect at once, the alive range is dense so the tail goes
+    mAliveCount = std::min(mAliveCount, mParticleLimit);
+
+    // Emission: rate plus any pending burst, capped by the free slots under the limit
+    mEmitAccumulator += mEmitter.rate * mRateScale * deltaTime;
+    size_t emitCount = static_cast<size_t>(mEmitAccumulator);
+    mEmitAccumulator -= static_cast<float>(emitCount);
+    emitCount += static_cast<size_t>(mPendingBurst);
+    mPendingBurst = 0;
+    emitCount = std::min(emitCount, mParticleLimit - mAliveCount);
+
+    // Idle emitter: nothing to simulate, upload or draw
+    size_t spawnEnd = mAliveCount + emitCount;
+    if (spawnEnd == 0) {
+        mDrawCount = 0;
+        mLastUpdateMs = 0.0f;
+        return;
+    }
+
+    // Particles live in the box plus the spawn band above it
+    mQuantMin = mBoxMin;
+    mQuantExtent = glm::max(mBoxMax + glm::vec3(0.0f, 2.0f, 0.0f) - mBoxMin, glm::vec3(1e-3f));
+
+    // Blocks write straight into this frame's region of the stream, particle i to slot i
+    if (!mDeferredUpload && mVAO == 0) createBuffers();
+    void* upload = mDeferredUpload ? mDeferredVertices.data() : mStream.beginWrite();
+    const size_t aliveEnd = mAliveCount;
+    if (colliders && colliders->isEmpty()) colliders = nullptr;
+    const size_t blockCount = (spawnEnd + UPDATE_BLOCK - 1) / UPDATE_BLOCK;
+    auto job = [&](size_t block) {
+        updateBlock(block, aliveEnd, spawnEnd, deltaTime, colliders, upload);
+    };
+    if (mThreadPool) {
+        mThreadPool->parallelFor(blockCount, job);
+    }
+    else {
+        for (size_t block = 0; block < blockCount; ++block) job(block);
+    }
+    mAliveCount = spawnEnd;
 
+    auto killStart = std::chrono::steady_clock::now();
+    killDead(upload);
 
-    mPositions[index] = glm::vec3(x, y, z);
-    mVelocities[index] = glm::vec3(0.0f, velocityY, 0.0f);
-    mLifetimes[index] = 5.0f; // lifetime
-    mActive[index] = true;
+    // Phase times summed over the blocks, compaction counts as update
+    mLastTimings = ParticleUpdateTimings();
+    mLastTimings.updateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - killStart).count();
+    for (size_t block = 0; block < blockCount; ++block) {
+        mLastTimings.updateMs += mBlockTimings[block].updateMs;
+        mLastTimings.spawnMs += mBlockTimings[block].spawnMs;
+        mLastTimings.uploadMs += mBlockTimings[block].uploadMs;
+    }
+    mLastTimings.updated = aliveEnd;
+    mLastTimings.spawned = emitCount;
+    mLastTimings.uploaded = spawnEnd;
+
+    if (!mDeferredUpload) {
+        mStream.endWrite(mAliveCount * getVertexStride());
+    }
+    mDrawCount = static_cast<int>(mAliveCount);
+
+    mLastUpdateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ParticleSystem::updateBlock(size_t block, size_t aliveEnd, size_t spawnEnd, float deltaTime,
+    const SpatialGrid* colliders, void* upload) {
+    size_t begin = block * UPDATE_BLOCK;
+    size_t end = std::min(begin + UPDATE_BLOCK, spawnEnd);
+    size_t integrateEnd = std::min(end, aliveEnd);
+    auto millisecondsSince = [](std::chrono::steady_clock::time_point& start) {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - start).count();
+        start = now;
+        return ms;
+    };
+    auto start = std::chrono::steady_clock::now();
+    BlockTimings& timings = mBlockTimings[block];
+
+    mBlockDeadCount[block] = 0;
+    if (begin < integrateEnd) {
+        mBlockDeadCount[block] = static_cast<uint32_t>(integrate(begin, integrateEnd, deltaTime, mDead.data() + begin));
+        if (colliders) {
+            collideBlock(block, begin, integrateEnd, *colliders);
+        }
+        if (mFormat != ParticleFormat::Float) {
+            cullOutOfBounds(block, begin, integrateEnd);
+        }
+    }
+    timings.updateMs = millisecondsSince(start);
+
+    if (std::max(begin, aliveEnd) < end) {
+        spawnParticles(std::max(begin, aliveEnd), end, mBlockRandom[block]);
+    }
+    timings.spawnMs = millisecondsSince(start);
+
+    writeVertices(upload, begin, end);
+    timings.uploadMs = millisecondsSince(start);
+}
+
+void ParticleSystem::cullOutOfBounds(size_t block, size_t begin, size_t end) {
+    // Append the particles outside the quantization bounds that integrate() didn't already
+    // kill, then merge so the block's list stays ascending for killDead()
+    uint32_t* dead = mDead.data() + begin;
+    const uint32_t deadCount = mBlockDeadCount[block];
+    const glm::vec3 quantMax = mQuantMin + mQuantExtent;
+    uint32_t count = deadCount;
+    uint32_t next = 0;
+    for (size_t i = begin; i < end; ++i) {
+        if (next < deadCount && dead[next] == i) {
+            ++next;
+            continue;
+        }
+        bool outside = mPosX[i] < mQuantMin.x || mPosX[i] > quantMax.x ||
+            mPosY[i] < mQuantMin.y || mPosY[i] > quantMax.y ||
+            mPosZ[i] < mQuantMin.z || mPosZ[i] > quantMax.z;
+        if (outside) dead[count++] = static_cast<uint32_t>(i);
+    }
+    if (count != deadCount) {
+        std::inplace_merge(dead, dead + deadCount, dead + count);
+        mBlockDeadCount[block] = count;
+    }
+}
+
+void ParticleSystem::collideBlock(size_t block, size_t begin, size_t end, const SpatialGrid& grid) {
+    CollisionScratch& scratch = mBlockCollision[block];
+
+    // Counting sort of the block's particles into the occupied cells. Most particles
+    // are in cells without spheres and only cost the lookup.
+    const size_t occupiedCount = grid.getOccupiedCount();
+    scratch.cells.resize(end - begin);
+    grid.findOccupiedCells(mPosX.data() + begin, mPosY.data() + begin, mPosZ.data() + begin, end - begin, scratch.cells.data());
+
+    // Branch-free compaction of the particles that landed in an occupied cell
+    scratch.binned.resize(end - begin);
+    scratch.candidates.resize(end - begin);
+    size_t candidateCount = 0;
+    for (size_t k = 0; k < end - begin; ++k) {
+        scratch.candidates[candidateCount] = static_cast<uint32_t>(k);
+        candidateCount += scratch.cells[k] >= 0;
+    }
+    if (candidateCount == 0) return;
+
+    scratch.cellStart.assign(occupiedCount + 1, 0);
+    for (size_t c = 0; c < candidateCount; ++c) {
+        scratch.cellStart[scratch.cells[scratch.candidates[c]] + 1]++;
+    }
+    for (size_t cell = 0; cell < occupiedCount; ++cell) {
+        scratch.cellStart[cell + 1] += scratch.cellStart[cell];
+    }
+    for (size_t c = 0; c < candidateCount; ++c) {
+        uint32_t k = scratch.candidates[c];
+        scratch.binned[scratch.cellStart[scratch.cells[k]]++] = static_cast<uint32_t>(begin + k);
+    }
+
+    const float* sphereX = grid.getX();
+    const float* sphereY = grid.getY();
+    const float* sphereZ = grid.getZ();
+    const float* sphereRadius = grid.getRadius();
+
+    // cellStart now holds each cell's end
+    uint32_t runBegin = 0;
+    for (size_t cellIndex = 0; cellIndex < occupiedCount; ++cellIndex) {
+        const int cell = static_cast<int>(cellIndex);
+        const uint32_t runEnd = scratch.cellStart[cell];
+        const uint32_t* particles = scratch.binned.data() + runBegin;
+        const size_t count = runEnd - runBegin;
+        runBegin = runEnd;
+        if (count == 0) continue;
+
+        // Gather the cell's particles; padding lanes sit far away and never hit
+        const size_t padded = (count + 3) & ~size_t(3);
+        scratch.x.assign(padded, 1e30f);
+        scratch.y.assign(padded, 1e30f);
+        scratch.z.assign(padded, 1e30f);
+        for (size_t k = 0; k < count; ++k) {
+            scratch.x[k] = mPosX[particles[k]];
+            scratch.y[k] = mPosY[particles[k]];
+            scratch.z[k] = mPosZ[particles[k]];
+        }
+
+        for (uint32_t s = grid.getCellBegin(cell); s < grid.getCellEnd(cell); ++s) {
+            const glm::vec3 center(sphereX[s], sphereY[s], sphereZ[s]);
+            const float radius = sphereRadius[s];
+
+            for (size_t k = 0; k < padded; k += 4) {
+#if defined(GE_SIMD_SSE)
+                __m128 dx = _mm_sub_ps(_mm_loadu_ps(scratch.x.data() + k), _mm_set1_ps(center.x));
+                __m128 dy = _mm_sub_ps(_mm_loadu_ps(scratch.y.data() + k), _mm_set1_ps(center.y));
+                __m128 dz = _mm_sub_ps(_mm_loadu_ps(scratch.z.data() + k), _mm_set1_ps(center.z));
+                __m128 distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                int hits = _mm_movemask_ps(_mm_cmplt_ps(distanceSq, _mm_set1_ps(radius * radius)));
+                if (!hits) continue;
+#else
+                int hits = 0;
+                for (int lane = 0; lane < 4; ++lane) {
+                    glm::vec3 d = glm::vec3(scratch.x[k + lane], scratch.y[k + lane], scratch.z[k + lane]) - center;
+                    if (glm::dot(d, d) < radius * radius) hits |= 1 << lane;
+                }
+#endif
+                while (hits) {
+                    int lane = 0;
+                    while (!(hits & (1 << lane))) ++lane;
+                    hits &= hits - 1;
+
+                    // Push out to the surface and reflect the inward velocity
+                    size_t slot = k + lane;
+                    uint32_t index = particles[slot];
+                    glm::vec3 offset = glm::vec3(scratch.x[slot], scratch.y[slot], scratch.z[slot]) - center;
+                    float distance = glm::length(offset);
+                    glm::vec3 normal = distance > 1e-6f ? offset / distance : glm::vec3(0.0f, 1.0f, 0.0f);
+                    glm::vec3 surface = center + normal * radius;
+                    scratch.x[slot] = surface.x;
+                    scratch.y[slot] = surface.y;
+                    scratch.z[slot] = surface.z;
+
+                    glm::vec3 velocity(mVelX[index], mVelY[index], mVelZ[index]);
+                    float normalSpeed = glm::dot(velocity, normal);
+                    if (normalSpeed < 0.0f) {
+                        velocity -= (1.0f + SPHERE_RESTITUTION) * normalSpeed * normal;
+                        mVelX[index] = velocity.x;
+                        mVelY[index] = velocity.y;
+                        mVelZ[index] = velocity.z;
+                    }
+                }
+            }
+        }
+
+        for (size_t k = 0; k < count; ++k) {
+            mPosX[particles[k]] = scratch.x[k];
+            mPosY[particles[k]] = scratch.y[k];
+            mPosZ[particles[k]] = scratch.z[k];
+        }
+    }
+}
+
+void ParticleSystem::killDead(void* upload) {
+    // Highest index first: everything above the current death is already compacted,
+    // so the last alive particle is never one still waiting to be removed
+    for (size_t block = mBlockDeadCount.size(); block-- > 0;) {
+        const uint32_t* dead = mDead.data() + block * UPDATE_BLOCK;
+        for (uint32_t k = mBlockDeadCount[block]; k-- > 0;) {
+            size_t index = dead[k];
+            if (index >= mAliveCount) continue;
+
+            size_t last = --mAliveCount;
+            if (index != last) {
+                mPosX[index] = mPosX[last];
+                mPosY[index] = mPosY[last];
+                mPosZ[index] = mPosZ[last];
+                mVelX[index] = mVelX[last];
+                mVelY[index] = mVelY[last];
+                mVelZ[index] = mVelZ[last];
+                mLifetimes[index] = mLifetimes[last];
+                mSpawnLifetimes[index] = mSpawnLifetimes[last];
+                writeVertices(upload, index, index + 1);
+            }
+        }
+        mBlockDeadCount[block] = 0;
+    }
+}
+
+size_t ParticleSystem::integrate(size_t begin, size_t end, float deltaTime, uint32_t* dead) {
+    ParticleStreams streams = {
+        mPosX.data(), mPosY.data(), mPosZ.data(),
+        mVelX.data(), mVelY.data(), mVelZ.data(),
+        mLifetimes.data()
+    };
+    return mEffect.integrate(mEffect, streams, begin, end, deltaTime, mBoxMin.y, dead);
+}
+
+void ParticleSystem::describe(RenderFrame& frame) const {
+    frame.drawCount = mDrawCount;
+    frame.boxMin = mBoxMin;
+    frame.boxMax = mBoxMax;
+    frame.quantMin = mQuantMin;
+    frame.quantExtent = mQuantExtent;
+    frame.colorOverLife = mEffect.colorOverLife;
+}
+
+void ParticleSystem::publish(RenderFrame& frame) const {
+    describe(frame);
+    size_t bytes = std::min(frame.drawCount * getVertexStride(frame.colorOverLife), mDeferredVertices.size());
+    frame.vertices.assign(mDeferredVertices.begin(), mDeferredVertices.begin() + bytes);
+}
+
+bool ParticleSystem::isVisible(const RenderFrame& frame, RenderView& renderView) const {
+    // Cull the whole emitter: particles live in the box plus the spawn band above it
+    glm::vec3 boundsMax = frame.boxMax + glm::vec3(0.0f, 2.0f, 0.0f);
+    glm::vec3 center = (frame.boxMin + boundsMax) * 0.5f;
+    return frame.drawCount > 0 && renderView.frustum.testSphere(center, glm::length(boundsMax - frame.boxMin) * 0.5f);
+}
+
+void ParticleSystem::render(Shader& shader, RenderQueue& queue, RenderView& renderView) {
+    RenderFrame frame;
+    describe(frame);
+    if (isVisible(frame, renderView)) {
+        submit(shader, queue, renderView, frame);
+    }
+}
+
+void ParticleSystem::render(Shader& shader, RenderQueue& queue, RenderView& renderView, const RenderFrame& frame) {
+    if (frame.vertices.empty() || !isVisible(frame, renderView)) return;
+    if (mVAO == 0) createBuffers();
+
+    void* upload = mStream.beginWrite();
+    std::memcpy(upload, frame.vertices.data(), frame.vertices.size());
+    mStream.endWrite(frame.vertices.size());
+    submit(shader, queue, renderView, frame);
+}
+
+void ParticleSystem::submit(Shader& shader, RenderQueue& queue, RenderView& renderView, const RenderFrame& frame) {
+    if (frame.colorOverLife != mBoundColorOverLife) {
+        bindVertexFormat(frame.colorOverLife);
+    }
+
+    if (frame.colorOverLife && !mVertexColorShader) {
+        mVertexColorShader = std::make_unique<Shader>("Exam.vs", "Exam.fs", "#define VERTEX_COLOR\n");
+    }
+
+    DrawPacket packet;
+    packet.shader = frame.colorOverLife ? mVertexColorShader.get() : &shader;
+    packet.vao = mVAO;
+    packet.mode = GL_POINTS;
+    packet.first = static_cast<GLint>(mStream.getDrawOffset() / getVertexStride(frame.colorOverLife));
+    packet.count = frame.drawCount;
+    if (mFormat != ParticleFormat::Float) {
+        // Decode the normalized position back into the bounds it was quantized against
+        packet.model = glm::scale(glm::translate(glm::mat4(1.0f), frame.quantMin), frame.quantExtent);
+    }
+    packet.color = glm::vec3(0.0f, 0.5f, 1.0f);
+    packet.flatColor = true;
+    packet.pointSize = 2.0f;
+    packet.stream = &mStream;
+    glm::vec3 center = (frame.boxMin + frame.boxMax + glm::vec3(0.0f, 2.0f, 0.0f)) * 0.5f;
+    queue.submit(packet, renderView.viewDepth(center), renderView);
+}
+
+void ParticleSystem::spawnParticles(size_t begin, size_t end, Random& random) {
+    size_t count = end - begin;
+
+    // Random x and z within the box bounds and a random height slightly above the box,
+    // generated straight into the streams
+    auto fill = [&](float* out, float low, float high) {
+        if (mVectorized) random.fill(out, count, low, high);
+        else random.fillScalar(out, count, low, high);
+    };
+    fill(mPosX.data() + begin, mBoxMin.x, mBoxMax.x);
+    fill(mPosZ.data() + begin, mBoxMin.z, mBoxMax.z);
+    fill(mPosY.data() + begin, mBoxMax.y, mBoxMax.y + 2.0f);
+
+    // Velocity per axis in the emitter's range, constant axes skip the generator
+    float* velocity[3] = { mVelX.data(), mVelY.data(), mVelZ.data() };
+    for (int axis = 0; axis < 3; ++axis) {
+        float low = mEmitter.velocityMin[axis];
+        float high = mEmitter.velocityMax[axis];
+        if (low == high) {
+            std::fill(velocity[axis] + begin, velocity[axis] + end, low);
+        }
+        else {
+            fill(velocity[axis] + begin, low, high);
+        }
+    }
+    std::fill(mLifetimes.begin() + begin, mLifetimes.begin() + end, mEmitter.lifetime);
+    std::fill(mSpawnLifetimes.begin() + begin, mSpawnLifetimes.begin() + end, mEmitter.lifetime);
 }
 
 void ParticleSystem::setBounds(const glm::vec3& boxMin, const glm::vec3& boxMax) {
@@ -1,31 +1,251 @@
 #pragma once
 #include <vector>
 #include <glm/glm.hpp>
-#include <cstdlib> 
-#include <ctime>
+#include <cstdint>
+#include <memory>
 #include "Shader.h"
+#include "RenderView.h"
+#include "StreamingBuffer.h"
+#include "RenderQueue.h"
+#include "Random.h"
+#include "SpatialGrid.h"
+#include "ParticleEffect.h"
+#include "StateHash.h"
+
+// Position layout of the per-frame particle stream. The quantized formats store the
+// position relative to the emitter bounds and are decoded by the draw's model matrix.
+// Effects with colour over life add an RGBA8 colour after it.
+enum class ParticleFormat {
+    Float,          // 3 x float, 12 bytes
+    Unorm16,        // 3 x normalized uint16, 6 bytes
+    Packed1010102   // GL_UNSIGNED_INT_2_10_10_10_REV normalized, 4 bytes
+};
+
+class ThreadPool;
+
+// CPU time per phase of one update(), summed over the update blocks (so across threads)
+struct ParticleUpdateTimings {
+    double updateMs = 0.0;      // Integrate, collisions and compaction
+    double spawnMs = 0.0;
+    double uploadMs = 0.0;      // Vertex writes into the stream
+    size_t updated = 0;         // Particles alive at the start of the update
+    size_t spawned = 0;
+    size_t uploaded = 0;
+};
 
 class ParticleSystem {
 public:
-    ParticleSystem(int maxParticles, const glm::vec3& boxMin, const glm::vec3& boxMax);
+    // Alive particles, emitter progress and RNG state, see saveState
+    struct Snapshot {
+        std::vector<float> posX, posY, posZ;
+        std::vector<float> velX, velY, velZ;
+        std::vector<float> lifetimes;
+        std::vector<float> spawnLifetimes;
+        std::vector<Random> blockRandom;
+        size_t aliveCount = 0;
+        float emitAccumulator = 0.0f;
+        int pendingBurst = 0;
+        size_t particleLimit = 0;
+        float rateScale = 1.0f;
+    };
+
+    // What render() needs from one update, copied out by publish() so it can be drawn
+    // on the GL thread while the next update runs
+    struct RenderFrame {
+        std::vector<unsigned char> vertices;    // drawCount vertices in the stream layout
+        int drawCount = 0;
+        glm::vec3 boxMin{ 0.0f };
+        glm::vec3 boxMax{ 0.0f };
+        glm::vec3 quantMin{ 0.0f };
+        glm::vec3 quantExtent{ 1.0f };
+        bool colorOverLife = false;
+    };
+
+    // Stream number assigned in construction order
+    static constexpr uint64_t AUTO_STREAM = ~0ULL;
+
+    // Each emitter draws from its own streams of the seed. Pass stream explicitly for
+    // results that don't depend on what else was constructed first.
+    // The pool starts full and keeps emitting maxParticles / 5 per second.
+    ParticleSystem(int maxParticles, const glm::vec3& boxMin, const glm::vec3& boxMax, uint64_t seed = Random::DEFAULT_SEED,
+        uint64_t stream = AUTO_STREAM);
+
+    // colliders: sphere grid of the same box, particles bounce off the spheres in it
+    void update(float deltaTime, const SpatialGrid* colliders = nullptr);
+    void render(Shader& shader, RenderQueue& queue, RenderView& renderView);
+
+    // Draws a published frame, uploading its vertices to the stream first
+    void render(Shader& shader, RenderQueue& queue, RenderView& renderView, const RenderFrame& frame);
+
+    // Copies the last update's draw state into frame; needs setDeferredUpload(true)
+    void publish(RenderFrame& frame) const;
+
+    // Keeps update() off the GL: vertices go to a CPU copy for publish() instead of the
+    // stream, so update() can run on a thread without the context. Nothing is drawn
+    // until the next update().
+    void setDeferredUpload(bool deferred);
 
-    void update(float deltaTime);
-    void render(Shader& shader, const glm::mat4& view, const glm::mat4& projection);
     void setBounds(const glm::vec3& boxMin, const glm::vec3& boxMax);
 
+    void setEmitter(const EmitterSettings& settings) { mEmitter = settings; }
+    const EmitterSettings& getEmitter() const { return mEmitter; }
+
+    // Replaces the emitter settings and the affector stack, compiled into one kernel
+    void setEffect(const ParticleEffect& effect);
+
+    // Emits count particles on the next update, on top of the rate
+    void burst(int count) { mPendingBurst += count; }
+
+    int getAliveCount() const { return static_cast<int>(mAliveCount); }
+    int getCapacity() const { return mMaxParticles; }
+    glm::vec3 getCenter() const { return (mBoxMin + mBoxMax) * 0.5f; }
+
+    // Set by the world's particle budget: caps the alive particles at limit (dropping
+    // any above it on the next update) and scales the emitter rate
+    void setBudget(size_t limit, float rateScale);
+    size_t getParticleLimit() const { return mParticleLimit; }
+
+    // Share of the budget relative to other emitters at the same distance
+    void setPriority(float priority) { mPriority = priority; }
+    float getPriority() const { return mPriority; }
+
+    // Adds the alive particles, emitter state and block generators to hash, all that
+    // saveState() keeps
+    void hashState(StateHash& hash) const;
+
+    // Copies the simulation state into snapshot, reusing its storage once it has grown.
+    // Restoring leaves the uploaded stream alone, so the particles drawn stay those of
+    // the last update() until the next one.
+    void saveState(Snapshot& snapshot) const;
+    void restoreState(const Snapshot& snapshot);
+
+    // CPU time of the last update()
+    float getLastUpdateMs() const { return mLastUpdateMs; }
+    const ParticleUpdateTimings& getLastTimings() const { return mLastTimings; }
+
+    // Pool the update blocks run on, the shared pool by default. nullptr runs them
+    // on the calling thread.
+    void setThreadPool(ThreadPool* pool) { mThreadPool = pool; }
+
+    // false runs the kernels and the RNG one float at a time, for benchmarks and tests.
+    // Results are the same either way.
+    void setVectorized(bool vectorized);
+    bool isVectorized() const { return mVectorized; }
+
+    // Takes effect from the next update(). Rebinds the VAO, so only from the GL thread
+    // and not while another thread updates. The quantized formats can only hold the box
+    // and spawn band, particles blown out of it die.
+    void setFormat(ParticleFormat format);
+    ParticleFormat getFormat() const { return mFormat; }
+
+    // Particles integrated per kernel iteration, the streams are padded to a multiple of it
+    static constexpr int PARTICLE_BLOCK = 16;
+
+    // Particles per thread pool job. Every update block has its own RNG stream and
+    // death list, so results do not depend on the number of threads.
+    static constexpr int UPDATE_BLOCK = 4096;
+
+    // Fraction of the normal speed kept when bouncing off a sphere
+    static constexpr float SPHERE_RESTITUTION = 0.2f;
+
 private:
-    void respawnParticle(int index);
+    // Fills [begin, end) with new particles
+    void spawnParticles(size_t begin, size_t end, Random& random);
+
+    // Runs the compiled effect over [begin, end): affectors, pos += vel * dt and life -= dt.
+    // Writes the particles that expired or hit the floor to dead and returns their count
+    size_t integrate(size_t begin, size_t end, float deltaTime, uint32_t* dead);
+
+    // Integrate the alive part of one update block, spawn into the rest of its new range
+    // and write the block to its slice of the upload
+    void updateBlock(size_t block, size_t aliveEnd, size_t spawnEnd, float deltaTime,
+        const SpatialGrid* colliders, void* upload);
+
+    // Encodes [begin, end) into upload in the current format
+    void writeVertices(void* upload, size_t begin, size_t end) const;
+
+    // VAO and stream, made by the first update or render that needs them so a system
+    // can be built and updated without a GL context
+    void createBuffers();
+
+    // The colour attribute follows the effect; render() rebinds when it changes
+    void bindVertexFormat(bool colorOverLife);
+    size_t getPositionStride() const;
+    size_t getColorOffset() const { return (getPositionStride() + 3) & ~size_t(3); }
+    size_t getVertexStride(bool colorOverLife) const;
+    size_t getVertexStride() const { return getVertexStride(mEffect.colorOverLife); }
+
+    // Fills everything in frame but the vertices
+    void describe(RenderFrame& frame) const;
+    bool isVisible(const RenderFrame& frame, RenderView& renderView) const;
+    void submit(Shader& shader, RenderQueue& queue, RenderView& renderView, const RenderFrame& frame);
+
+    // Bins [begin, end) into the occupied grid cells and pushes particles out of the spheres
+    void collideBlock(size_t block, size_t begin, size_t end, const SpatialGrid& grid);
+    // Adds the particles outside the quantization bounds to the block's deaths
+    void cullOutOfBounds(size_t block, size_t begin, size_t end);
+
+    // Swap-with-last removal of the collected deaths, keeping the upload in step
+    void killDead(void* upload);
 
     int mMaxParticles;
     glm::vec3 mBoxMin;
     glm::vec3 mBoxMax;
 
-    // Structure of Arrays (SoA) for particle data
-    std::vector<glm::vec3> mPositions; 
-    std::vector<glm::vec3> mVelocities; 
-    std::vector<float> mLifetimes;     
-    std::vector<bool> mActive;         
+    // Structure of Arrays (SoA) for particle data, one float stream per component.
+    // [0, mAliveCount) is alive, the rest is free.
+    std::vector<float> mPosX, mPosY, mPosZ;
+    std::vector<float> mVelX, mVelY, mVelZ;
+    std::vector<float> mLifetimes;      // Seconds left
+    std::vector<float> mSpawnLifetimes; // Seconds at spawn, what colour over life measures the age against
+    size_t mAliveCount = 0;
 
-    unsigned int mVAO, mVBO; 
-};
+    EmitterSettings mEmitter;
+    CompiledEffect mEffect;
+    float mEmitAccumulator = 0.0f;      // Fractional particles carried to the next update
+    int mPendingBurst = 0;
+
+    size_t mParticleLimit = 0;
+    float mRateScale = 1.0f;
+    float mPriority = 1.0f;
+    float mLastUpdateMs = 0.0f;
+    ParticleUpdateTimings mLastTimings;
+
+    ThreadPool* mThreadPool = nullptr;
+    bool mVectorized = true;
+
+    std::vector<uint32_t> mDead;        // Indices collected by integrate(), one range per update block
+    std::vector<uint32_t> mBlockDeadCount;
+    std::vector<Random> mBlockRandom;
 
+    struct BlockTimings {
+        double updateMs = 0.0;
+        double spawnMs = 0.0;
+        double uploadMs = 0.0;
+    };
+    std::vector<BlockTimings> mBlockTimings;
+
+    // Per update block scratch for sphere collision
+    struct CollisionScratch {
+        std::vector<int> cells;         // Occupied cell per particle of the block, -1 for none
+        std::vector<uint32_t> candidates;   // Block offsets of the particles in an occupied cell
+        std::vector<uint32_t> cellStart;
+        std::vector<uint32_t> binned;   // Particle indices grouped by cell
+        std::vector<float> x, y, z;     // Positions of one cell's particles
+    };
+    std::vector<CollisionScratch> mBlockCollision;
+
+    ParticleFormat mFormat = ParticleFormat::Float;
+    glm::vec3 mQuantMin{ 0.0f };        // Bounds the quantized formats are relative to
+    glm::vec3 mQuantExtent{ 1.0f };
+
+    unsigned int mVAO = 0;
+    std::unique_ptr<Shader> mVertexColorShader;    // Colour over life reads the colour from the stream, built on first use
+    StreamingBuffer mStream;    // Alive particle positions, written straight from update()
+    int mDrawCount = 0;
+    bool mBoundColorOverLife = false;
+
+    // update() output while deferred, one stream region's worth
+    bool mDeferredUpload = false;
+    std::vector<unsigned char> mDeferredVertices;
+};
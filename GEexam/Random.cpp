@@ -0,0 +1,173 @@
+#include "Random.h"
+#include "Simd.h"
+#include <atomic>
+#include <cstring>
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// Expands one 64-bit seed into well-mixed state words
+static inline uint64_t splitMix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Top 23 bits as the mantissa of a float in [1, 2), minus one
+static inline float toUnitFloat(uint32_t bits) {
+    uint32_t mantissa = (bits >> 9) | 0x3F800000u;
+    float f;
+    std::memcpy(&f, &mantissa, sizeof(f));
+    return f - 1.0f;
+}
+
+Random::Random(uint64_t seed, uint64_t stream) {
+    this->seed(seed, stream);
+}
+
+void Random::seed(uint64_t seed, uint64_t stream) {
+    uint64_t mix = seed;
+    uint64_t streamMix = stream;
+    mix ^= splitMix64(streamMix);
+
+    for (uint64_t& word : mState) {
+        word = splitMix64(mix);
+    }
+    for (int lane = 0; lane < LANES; ++lane) {
+        for (int word = 0; word < 4; ++word) {
+            mLanes[word][lane] = splitMix64(mix);
+        }
+    }
+}
+
+uint64_t Random::next() {
+    const uint64_t result = rotl(mState[0] + mState[3], 23) + mState[0];
+    const uint64_t t = mState[1] << 17;
+
+    mState[2] ^= mState[0];
+    mState[3] ^= mState[1];
+    mState[1] ^= mState[2];
+    mState[0] ^= mState[3];
+    mState[2] ^= t;
+    mState[3] = rotl(mState[3], 45);
+
+    return result;
+}
+
+float Random::nextFloat() {
+    return toUnitFloat(static_cast<uint32_t>(next() >> 32));
+}
+
+float Random::range(float low, float high) {
+    return low + nextFloat() * (high - low);
+}
+
+#if defined(GE_SIMD_SSE)
+// One xoshiro256++ step for two 64-bit generators per register
+static inline __m128i stepPair(__m128i& s0, __m128i& s1, __m128i& s2, __m128i& s3) {
+    __m128i sum = _mm_add_epi64(s0, s3);
+    __m128i result = _mm_add_epi64(_mm_or_si128(_mm_slli_epi64(sum, 23), _mm_srli_epi64(sum, 41)), s0);
+    __m128i t = _mm_slli_epi64(s1, 17);
+
+    s2 = _mm_xor_si128(s2, s0);
+    s3 = _mm_xor_si128(s3, s1);
+    s1 = _mm_xor_si128(s1, s2);
+    s0 = _mm_xor_si128(s0, s3);
+    s2 = _mm_xor_si128(s2, t);
+    s3 = _mm_or_si128(_mm_slli_epi64(s3, 45), _mm_srli_epi64(s3, 19));
+    return result;
+}
+#endif
+
+void Random::stepLanes(uint32_t out[LANES * 2]) {
+    for (int lane = 0; lane < LANES; ++lane) {
+        uint64_t& s0 = mLanes[0][lane];
+        uint64_t& s1 = mLanes[1][lane];
+        uint64_t& s2 = mLanes[2][lane];
+        uint64_t& s3 = mLanes[3][lane];
+
+        const uint64_t result = rotl(s0 + s3, 23) + s0;
+        const uint64_t t = s1 << 17;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = rotl(s3, 45);
+
+        // Same little-endian 32-bit halves an SSE store of the lane pair produces
+        out[lane * 2] = static_cast<uint32_t>(result);
+        out[lane * 2 + 1] = static_cast<uint32_t>(result >> 32);
+    }
+}
+
+void Random::fill(float* out, size_t count, float low, float high) {
+    size_t i = 0;
+
+#if defined(GE_SIMD_SSE)
+    const float scale = high - low;
+
+    // Lanes 0-1 in register a, 2-3 in register b, kept in registers for the whole fill
+    __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mLanes[0][0]));
+    __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mLanes[1][0]));
+    __m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mLanes[2][0]));
+    __m128i a3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mLanes[3][0]));
+    __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mLanes[0][2]));
+    __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mLanes[1][2]));
+    __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mLanes[2][2]));
+    __m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mLanes[3][2]));
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 lowV = _mm_set1_ps(low);
+    const __m128 scaleV = _mm_set1_ps(scale);
+    const __m128i exponent = _mm_set1_epi32(0x3F800000);
+    for (; i + LANES * 2 <= count; i += LANES * 2) {
+        __m128i rawA = stepPair(a0, a1, a2, a3);
+        __m128i rawB = stepPair(b0, b1, b2, b3);
+        __m128 unitA = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(rawA, 9), exponent)), one);
+        __m128 unitB = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(rawB, 9), exponent)), one);
+        _mm_storeu_ps(out + i, _mm_add_ps(lowV, _mm_mul_ps(unitA, scaleV)));
+        _mm_storeu_ps(out + i + 4, _mm_add_ps(lowV, _mm_mul_ps(unitB, scaleV)));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&mLanes[0][0]), a0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&mLanes[1][0]), a1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&mLanes[2][0]), a2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&mLanes[3][0]), a3);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&mLanes[0][2]), b0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&mLanes[1][2]), b1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&mLanes[2][2]), b2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&mLanes[3][2]), b3);
+#endif
+
+    fillScalar(out + i, count - i, low, high);
+}
+
+void Random::fillScalar(float* out, size_t count, float low, float high) {
+    const float scale = high - low;
+    uint32_t bits[LANES * 2];
+    size_t i = 0;
+    for (; i + LANES * 2 <= count; i += LANES * 2) {
+        stepLanes(bits);
+        for (int k = 0; k < LANES * 2; ++k) {
+            out[i + k] = low + toUnitFloat(bits[k]) * scale;
+        }
+    }
+
+    // Partial last step, the unused values are dropped
+    if (i < count) {
+        stepLanes(bits);
+        for (int k = 0; i < count; ++i, ++k) {
+            out[i] = low + toUnitFloat(bits[k]) * scale;
+        }
+    }
+}
+
+Random& Random::threadLocal() {
+    // Streams handed out in thread start order, kept clear of small per-emitter stream ids
+    static std::atomic<uint64_t> nextThreadStream{ 1ULL << 32 };
+    thread_local Random random(DEFAULT_SEED, nextThreadStream.fetch_add(1));
+    return random;
+}
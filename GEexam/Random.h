@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// xoshiro256++ generator. Every instance is an independent stream: the same
+// (seed, stream) pair always reproduces the same sequence, on every build.
+class Random {
+public:
+    static constexpr uint64_t DEFAULT_SEED = 0x2545F4914F6CDD1DULL;
+
+    explicit Random(uint64_t seed = DEFAULT_SEED, uint64_t stream = 0);
+
+    void seed(uint64_t seed, uint64_t stream = 0);
+
+    uint64_t next();
+    float nextFloat();                      // [0, 1)
+    float range(float low, float high);     // [low, high)
+
+    // Batch fill from four interleaved lanes, 8 floats per step (SSE2 when available,
+    // scalar otherwise - both give identical output).
+    void fill(float* out, size_t count, float low, float high);
+
+    // fill() without SSE, same output
+    void fillScalar(float* out, size_t count, float low, float high);
+
+    // Per-thread stream, for code that has no generator of its own
+    static Random& threadLocal();
+
+private:
+    static constexpr int LANES = 4;
+
+    uint64_t mState[4];
+    uint64_t mLanes[4][LANES];  // Word-major so two lanes load as one SSE register
+
+    // Scalar lane step, used by fillScalar()
+    void stepLanes(uint32_t out[LANES * 2]);
+};
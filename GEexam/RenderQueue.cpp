@@ -0,0 +1,199 @@
+#include "RenderQueue.h"
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include "ComponentManager.h"
+#include "SystemManager.h"
+
+uint64_t RenderQueue::makeKey(uint32_t programIndex, GLuint vao, uint32_t material, float depth, float farPlane) {
+    // Front to back within the same state, which helps early depth rejection
+    float normalizedDepth = glm::clamp(depth / farPlane, 0.0f, 1.0f);
+    uint64_t depthBits = static_cast<uint64_t>(normalizedDepth * 0xFFFFFF);
+
+    return (static_cast<uint64_t>(programIndex & 0xFF) << 56) |
+        (static_cast<uint64_t>(vao & 0xFFFF) << 40) |
+        (static_cast<uint64_t>(material & 0xFFFF) << 24) |
+        depthBits;
+}
+
+uint32_t RenderQueue::programIndex(const Shader& shader) {
+    auto it = std::find(mProgramIndices.begin(), mProgramIndices.end(), shader.ID);
+    if (it != mProgramIndices.end()) {
+        return static_cast<uint32_t>(it - mProgramIndices.begin());
+    }
+    mProgramIndices.push_back(shader.ID);
+    return static_cast<uint32_t>(mProgramIndices.size() - 1);
+}
+
+uint32_t RenderQueue::materialId(const DrawPacket& packet) {
+    // FNV-1a over the material fields; a collision only costs sort quality, not correctness
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    };
+    mix(&packet.color, sizeof(packet.color));
+    mix(&packet.flatColor, sizeof(packet.flatColor));
+    mix(&packet.pointSize, sizeof(packet.pointSize));
+    return (hash ^ (hash >> 16)) & 0xFFFF;
+}
+
+void RenderQueue::bindInstanceAttributes(size_t firstInstance) {
+    const GLsizei stride = sizeof(InstanceData);
+    const size_t base = firstInstance * sizeof(InstanceData);
+    for (GLuint column = 0; column < 4; ++column) {
+        glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, stride,
+            (void*)(base + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+    }
+    for (GLuint column = 0; column < 3; ++column) {
+        glVertexAttribPointer(6 + column, 3, GL_FLOAT, GL_FALSE, stride,
+            (void*)(base + offsetof(InstanceData, normal) + column * sizeof(glm::vec3)));
+    }
+    glVertexAttribPointer(9, 3, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(InstanceData, color)));
+}
+
+void RenderQueue::clear() {
+    mPackets.clear();
+}
+
+void RenderQueue::submit(DrawPacket packet, float depth, const RenderView& renderView) {
+    packet.key = makeKey(programIndex(*packet.shader), packet.vao, materialId(packet), depth, renderView.farPlane());
+    mPackets.push_back(packet);
+}
+
+// LSD radix sort on 8-bit digits, skipping digits every key shares
+void RenderQueue::sort() {
+    const size_t count = mPackets.size();
+    mKeys.resize(count);
+    mKeysScratch.resize(count);
+    mOrder.resize(count);
+    mOrderScratch.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        mKeys[i] = mPackets[i].key;
+        mOrder[i] = static_cast<uint32_t>(i);
+    }
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (size_t i = 0; i < count; ++i) {
+            histogram[(mKeys[i] >> shift) & 0xFF]++;
+        }
+        if (count == 0 || histogram[(mKeys[0] >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t& bucket : histogram) {
+            size_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            size_t destination = histogram[(mKeys[i] >> shift) & 0xFF]++;
+            mKeysScratch[destination] = mKeys[i];
+            mOrderScratch[destination] = mOrder[i];
+        }
+        mKeys.swap(mKeysScratch);
+        mOrder.swap(mOrderScratch);
+    }
+}
+
+void RenderQueue::flush(const RenderView& renderView) {
+    sort();
+
+    mFrame++;
+    mState.invalidate();
+    for (uint32_t index : mOrder) {
+        const DrawPacket& packet = mPackets[index];
+        bindProgram(packet, renderView);
+        bindGeometry(packet);
+        draw(packet);
+    }
+
+    if (mState.vao != 0) {
+        glBindVertexArray(0);
+        mState.vao = 0;
+    }
+}
+
+void RenderQueue::bindProgram(const DrawPacket& packet, const RenderView& renderView) {
+    GLuint program = packet.shader->ID;
+    if (mState.program != program) {
+        glUseProgram(program);
+        mState.program = program;
+    }
+
+    auto inserted = mState.programs.try_emplace(program);
+    GLStateCache::ProgramState& state = inserted.first->second;
+    if (inserted.second) {
+        state.modelLocation = glGetUniformLocation(program, "model");
+        state.viewLocation = glGetUniformLocation(program, "view");
+        state.projectionLocation = glGetUniformLocation(program, "projection");
+        state.objectColorLocation = glGetUniformLocation(program, "objectColor");
+        state.useFlatColorLocation = glGetUniformLocation(program, "useFlatColor");
+    }
+
+    // Camera and lighting once per program per frame
+    if (state.frame != mFrame) {
+        state.frame = mFrame;
+        glUniformMatrix4fv(state.viewLocation, 1, GL_FALSE, &renderView.view[0][0]);
+        glUniformMatrix4fv(state.projectionLocation, 1, GL_FALSE, &renderView.projection[0][0]);
+        applySceneLighting(*packet.shader);
+    }
+
+    // Material, only what changed since this program's last draw
+    bool first = !state.hasMaterial;
+    state.hasMaterial = true;
+    if (packet.instanceCount == 0 && (first || state.model != packet.model)) {
+        glUniformMatrix4fv(state.modelLocation, 1, GL_FALSE, &packet.model[0][0]);
+        state.model = packet.model;
+    }
+    if (first || state.color != packet.color) {
+        glUniform3fv(state.objectColorLocation, 1, &packet.color[0]);
+        state.color = packet.color;
+    }
+    if (first || state.flatColor != packet.flatColor) {
+        glUniform1i(state.useFlatColorLocation, packet.flatColor ? 1 : 0);
+        state.flatColor = packet.flatColor;
+    }
+}
+
+void RenderQueue::bindGeometry(const DrawPacket& packet) {
+    if (mState.vao != packet.vao) {
+        glBindVertexArray(packet.vao);
+        mState.vao = packet.vao;
+    }
+
+    if (packet.instanceCount > 0) {
+        GLStateCache::InstanceBinding& binding = mState.instanceBindings[packet.vao];
+        if (binding.buffer != packet.instanceBuffer || binding.firstInstance != packet.firstInstance) {
+            glBindBuffer(GL_ARRAY_BUFFER, packet.instanceBuffer);
+            bindInstanceAttributes(packet.firstInstance);
+            binding.buffer = packet.instanceBuffer;
+            binding.firstInstance = packet.firstInstance;
+        }
+    }
+
+    if (packet.mode == GL_POINTS && mState.pointSize != packet.pointSize) {
+        glPointSize(packet.pointSize);
+        mState.pointSize = packet.pointSize;
+    }
+}
+
+void RenderQueue::draw(const DrawPacket& packet) {
+    if (packet.instanceCount > 0) {
+        glDrawArraysInstanced(packet.mode, packet.first, packet.count, packet.instanceCount);
+    }
+    else if (packet.indexed) {
+        glDrawElements(packet.mode, packet.count, GL_UNSIGNED_INT, (void*)(packet.first * sizeof(GLuint)));
+    }
+    else {
+        glDrawArrays(packet.mode, packet.first, packet.count);
+    }
+
+    if (packet.stream) {
+        packet.stream->fenceDrawnRegion();
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Shader.h"
+#include "RenderView.h"
+#include "StreamingBuffer.h"
+
+// Everything needed to issue one draw, plus the key it is sorted by
+struct DrawPacket {
+    uint64_t key = 0;
+
+    Shader* shader = nullptr;
+    GLuint vao = 0;
+    GLenum mode = GL_TRIANGLES;
+    bool indexed = false;
+    GLint first = 0;
+    GLsizei count = 0;
+
+    // Instanced draws: instanceCount > 0, instances start at firstInstance in instanceBuffer
+    GLsizei instanceCount = 0;
+    GLuint instanceBuffer = 0;
+    size_t firstInstance = 0;
+
+    // Material
+    glm::mat4 model{ 1.0f };
+    glm::vec3 color{ 1.0f };
+    bool flatColor = false;
+    float pointSize = 1.0f;
+
+    // Stream whose region this draw reads, fenced right after the draw
+    StreamingBuffer* stream = nullptr;
+};
+
+// Last GL state set by the queue, so submit() can skip redundant calls
+struct GLStateCache {
+    struct ProgramState {
+        // Uniform locations, looked up once per program
+        GLint modelLocation = -1, viewLocation = -1, projectionLocation = -1;
+        GLint objectColorLocation = -1, useFlatColorLocation = -1;
+
+        uint32_t frame = 0;     // Frame the view/projection/lighting uniforms were last set in
+        bool hasMaterial = false;
+        glm::mat4 model{ 1.0f };
+        glm::vec3 color{ 0.0f };
+        bool flatColor = false;
+    };
+
+    struct InstanceBinding {
+        GLuint buffer = 0;
+        size_t firstInstance = 0;
+    };
+
+    GLuint program = 0;
+    GLuint vao = 0;
+    float pointSize = 0.0f;
+    std::unordered_map<GLuint, ProgramState> programs;
+    std::unordered_map<GLuint, InstanceBinding> instanceBindings;
+
+    // Other code binds VAOs and buffers outside the queue, so start each submit from scratch
+    void invalidate() {
+        program = 0;
+        vao = 0;
+        pointSize = 0.0f;
+        instanceBindings.clear();
+    }
+};
+
+// Collects draw packets from every system, sorts them by key and submits them with
+// as few state changes as possible, independent of the order they were submitted in.
+class RenderQueue {
+public:
+    // Key layout, high to low: program (8) | mesh (16) | material (16) | depth (24).
+    // Depth is view-space distance, normalized by the far plane.
+    static uint64_t makeKey(uint32_t programIndex, GLuint vao, uint32_t material, float depth, float farPlane);
+
+    // Fills in the key from the packet's shader, mesh and material and queues it
+    void submit(DrawPacket packet, float depth, const RenderView& renderView);
+
+    // Small stable index per program so it fits in the key
+    uint32_t programIndex(const Shader& shader);
+    static uint32_t materialId(const DrawPacket& packet);
+
+    // Points the instance attributes (locations 2-9 in Exam.vs) at firstInstance in the bound
+    // GL_ARRAY_BUFFER. GL 3.3 has no base instance, so ranges are selected through the offsets.
+    static void bindInstanceAttributes(size_t firstInstance);
+
+    void clear();
+
+    // Radix-sorts the packets and issues them
+    void flush(const RenderView& renderView);
+
+    size_t getPacketCount() const { return mPackets.size(); }
+
+private:
+    std::vector<DrawPacket> mPackets;
+    std::vector<uint32_t> mOrder, mOrderScratch;
+    std::vector<uint64_t> mKeys, mKeysScratch;
+    std::vector<GLuint> mProgramIndices;
+
+    GLStateCache mState;
+    uint32_t mFrame = 0;
+
+    void sort();
+    void bindProgram(const DrawPacket& packet, const RenderView& renderView);
+    void bindGeometry(const DrawPacket& packet);
+    void draw(const DrawPacket& packet);
+};
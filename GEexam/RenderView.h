@@ -0,0 +1,41 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+// Per-frame camera data handed down the render path
+struct RenderView {
+    glm::mat4 view{ 1.0f };
+    glm::mat4 projection{ 1.0f };
+    Frustum frustum;
+    float viewportWidth = 1280.0f;
+    float viewportHeight = 720.0f;
+
+    // How far the frame is between the last two fixed steps, 1 = the latest state
+    float interpolation = 1.0f;
+
+    // Distance in front of the camera along the view direction
+    float viewDepth(const glm::vec3& point) const {
+        return -(view[0][2] * point.x + view[1][2] * point.y + view[2][2] * point.z + view[3][2]);
+    }
+
+    // World-space camera position, the view matrix's inverse translation
+    glm::vec3 cameraPosition() const {
+        return -(glm::transpose(glm::mat3(view)) * glm::vec3(view[3]));
+    }
+
+    // Far plane distance recovered from a perspective projection
+    float farPlane() const {
+        return projection[3][2] / (projection[2][2] + 1.0f);
+    }
+
+    // Approximate on-screen radius in pixels of a world-space sphere, along whichever axis
+    // it covers more pixels: a projection whose aspect doesn't match the viewport stretches it
+    float projectedRadius(const glm::vec3& center, float radius) const {
+        float depth = viewDepth(center);
+        float pixelsPerUnit = 0.5f * glm::max(projection[0][0] * viewportWidth, projection[1][1] * viewportHeight);
+        if (depth <= radius) {
+            return glm::max(viewportWidth, viewportHeight); // Camera is inside or touching the sphere
+        }
+        return radius * pixelsPerUnit / depth;
+    }
+};
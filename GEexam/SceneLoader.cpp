@@ -0,0 +1,161 @@
+#include "SceneLoader.h"
+#include "Random.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+static glm::vec3 readVec3(std::istringstream& in) {
+    glm::vec3 v(0.0f);
+    in >> v.x >> v.y >> v.z;
+    return v;
+}
+
+std::unique_ptr<World> loadScene(const char* path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::fprintf(stderr, "Can't open scene %s\n", path);
+        return nullptr;
+    }
+
+    // Settings apply when the file is done, so their order against spheres doesn't matter
+    uint64_t seed = Random::DEFAULT_SEED;
+    std::unique_ptr<World> world;
+    PhysicsSettings physics;
+    ParticleEffect effect;
+    bool effectDefined = false;
+    bool deterministic = false;
+    glm::vec3 firstBoxMin(0.0f), firstBoxMax(0.0f);
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        std::string command;
+        if (!(in >> command)) continue;
+
+        // Checked once a command's required arguments are read
+        auto badArguments = [&]() -> std::unique_ptr<World> {
+            std::fprintf(stderr, "%s:%d: bad arguments to %s\n", path, lineNumber, command.c_str());
+            return nullptr;
+        };
+
+        if (command == "seed") {
+            if (world) {
+                std::fprintf(stderr, "%s:%d: seed after the first box\n", path, lineNumber);
+                return nullptr;
+            }
+            in >> seed;
+            if (in.fail()) return badArguments();
+        }
+        else if (command == "box") {
+            glm::vec3 position = readVec3(in);
+            glm::vec3 size = readVec3(in);
+            if (in.fail()) return badArguments();
+            if (!world) {
+                world = std::make_unique<World>(seed);
+                world->setHeadless(true);
+                firstBoxMin = position - size * 0.5f;
+                firstBoxMax = position + size * 0.5f;
+            }
+            world->addBox(position, size);
+        }
+        else if (!world && (command == "sphere" || command == "spheres" || command == "joint" || command == "priority")) {
+            std::fprintf(stderr, "%s:%d: %s before the first box\n", path, lineNumber, command.c_str());
+            return nullptr;
+        }
+        else if (command == "sphere") {
+            glm::vec3 position = readVec3(in);
+            glm::vec3 velocity = readVec3(in);
+            float radius = 1.0f;
+            in >> radius;
+            if (in.fail()) return badArguments();
+            world->createSphereEntity(position, velocity, radius, glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+        else if (command == "spheres") {
+            int count = 0;
+            float radius = 1.0f, speed = 0.0f;
+            in >> count >> radius >> speed;
+            if (in.fail() || count < 0) return badArguments();
+
+            // Own stream of the seed, apart from the boxes' particle streams
+            Random random(seed, 0xFFFF);
+            glm::vec3 low = glm::min(firstBoxMin + radius, firstBoxMax - radius);
+            glm::vec3 high = glm::max(firstBoxMin + radius, firstBoxMax - radius);
+            for (int i = 0; i < count; ++i) {
+                glm::vec3 position(random.range(low.x, high.x), random.range(low.y, high.y), random.range(low.z, high.z));
+                glm::vec3 direction(random.range(-1.0f, 1.0f), random.range(-1.0f, 1.0f), random.range(-1.0f, 1.0f));
+                float length = glm::length(direction);
+                glm::vec3 velocity = length > 1e-6f ? direction * (speed / length) : glm::vec3(0.0f);
+                world->createSphereEntity(position, velocity, radius, glm::vec3(random.nextFloat(), random.nextFloat(), 1.0f));
+            }
+        }
+        else if (command == "joint") {
+            uint32_t a = 0, b = 0;
+            float stiffness = 0.0f, damping = 0.0f, rest = -1.0f;
+            in >> a >> b >> stiffness >> damping;
+            if (in.fail()) return badArguments();
+
+            // The rest length is optional: only an unreadable one is an error, a missing one
+            // keeps the current distance
+            if (!(in >> rest)) {
+                if (!in.eof()) return badArguments();
+                rest = -1.0f;
+            }
+            if (!world->addJoint(a, b, stiffness, damping, rest)) {
+                std::fprintf(stderr, "%s:%d: can't join %u and %u\n", path, lineNumber, a, b);
+                return nullptr;
+            }
+        }
+        else if (command == "priority") {
+            size_t box = 0;
+            float priority = 1.0f;
+            in >> box >> priority;
+            if (in.fail()) return badArguments();
+            world->setParticlePriority(box, priority);
+        }
+        else if (command == "gravity") {
+            physics.gravity = readVec3(in);
+            if (in.fail()) return badArguments();
+        }
+        else if (command == "drag") {
+            in >> physics.linearDrag;
+            if (in.fail()) return badArguments();
+        }
+        else if (command == "restitution") {
+            in >> physics.contacts.restitution;
+            if (in.fail()) return badArguments();
+        }
+        else if (command == "iterations") {
+            in >> physics.contacts.iterations;
+            if (in.fail()) return badArguments();
+        }
+        else if (command == "mode") {
+            std::string mode;
+            in >> mode;
+            if (mode != "fixed" && mode != "event") return badArguments();
+            physics.mode = mode == "event" ? SimulationMode::EventDriven : SimulationMode::FixedStep;
+        }
+        else if (command == "emitter") {
+            in >> effect.emitter.rate >> effect.emitter.lifetime;
+            if (in.fail()) return badArguments();
+            effectDefined = true;
+        }
+        else if (command == "deterministic") {
+            deterministic = true;
+        }
+        else {
+            std::fprintf(stderr, "%s:%d: unknown command %s\n", path, lineNumber, command.c_str());
+            return nullptr;
+        }
+    }
+
+    if (!world) {
+        std::fprintf(stderr, "%s: no box\n", path);
+        return nullptr;
+    }
+    world->setPhysicsSettings(physics);
+    if (effectDefined) world->setParticleEffect(effect);
+    world->setDeterministic(deterministic);
+    return world;
+}
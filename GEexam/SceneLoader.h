@@ -0,0 +1,20 @@
+#pragma once
+#include "World.h"
+#include <memory>
+
+// Scene files hold one command per line, # starts a comment:
+//
+//   seed <n>                                  before the first box
+//   box <x y z> <sx sy sz>                    centre and size; spheres go in the first box
+//   sphere <x y z> <vx vy vz> <radius>
+//   spheres <count> <radius> <speed>          random positions and directions in the first box
+//   joint <a> <b> <stiffness> <damping> [rest]
+//   gravity <x y z> | drag <k> | restitution <e> | iterations <n> | mode fixed|event
+//   emitter <rate> <lifetime>
+//   priority <box> <priority>                 particle budget share, boxes counted from 0
+//   deterministic
+//
+// Builds a headless World from the scene at path. nullptr, with path:line and the reason
+// on stderr, when the file can't be read or has an error: an unknown command, missing or
+// unreadable arguments, or a joint addJoint() rejects.
+std::unique_ptr<World> loadScene(const char* path);
@@ -0,0 +1,198 @@
+#include "ScriptBindings.h"
+#include <iostream>
+
+// Link to lua library
+#ifdef _WIN32
+#pragma comment(lib, "lua54/lua54.lib")
+#endif
+
+ComponentArrays gComponents;
+
+int lua_createEntity(lua_State* L) {
+    uint32_t entity = gComponents.transforms.size();
+    gComponents.resize(entity + 1);
+
+    std::cout << "Lua created entity ID: " << entity << std::endl;
+
+    lua_pushinteger(L, entity); // Return entity ID
+    return 1; // Number of return values
+}
+
+
+
+int lua_setPosition(lua_State* L) {
+    uint32_t entity = lua_tointeger(L, 1); // Get entity ID
+    float x = lua_tonumber(L, 2);          // Get x coordinate
+    float y = lua_tonumber(L, 3);          // Get y coordinate
+    float z = lua_tonumber(L, 4);          // Get z coordinate
+
+
+    if (entity < gComponents.transforms.size()) {
+        gComponents.transforms[entity].position = { x, y, z };
+    }
+    else {
+        std::cerr << "Invalid entity ID: " << entity << std::endl;
+    }
+
+    return 0; // No return values
+}
+
+int lua_setVelocity(lua_State* L) {
+    uint32_t entity = lua_tointeger(L, 1);
+    float vx = lua_tonumber(L, 2);
+    float vy = lua_tonumber(L, 3);
+    float vz = lua_tonumber(L, 4);
+
+    if (entity < gComponents.physics.size()) {
+        gComponents.physics[entity].velocity = { vx, vy, vz };
+    }
+    else {
+        std::cerr << "Invalid entity ID: " << entity << std::endl;
+    }
+
+    return 0;
+}
+
+int lua_setColor(lua_State* L) {
+    uint32_t entity = lua_tointeger(L, 1);
+    float r = lua_tonumber(L, 2);
+    float g = lua_tonumber(L, 3);
+    float b = lua_tonumber(L, 4);
+
+    if (entity < gComponents.renders.size()) {
+        gComponents.renders[entity].color = { r, g, b };
+    }
+    else {
+        std::cerr << "Invalid entity ID: " << entity << std::endl;
+    }
+
+    return 0;
+}
+
+
+// Particle effect built by the script, applied to the world after each load
+ParticleEffect gParticleEffect;
+bool gParticleEffectDefined = false;
+
+int lua_setEmitter(lua_State* L) {
+    gParticleEffect.emitter.rate = lua_tonumber(L, 1);      // Particles per second
+    gParticleEffect.emitter.lifetime = lua_tonumber(L, 2);  // Seconds
+    gParticleEffectDefined = true;
+    return 0;
+}
+
+int lua_addGravity(lua_State* L) {
+    glm::vec3 acceleration(lua_tonumber(L, 1), lua_tonumber(L, 2), lua_tonumber(L, 3));
+    gParticleEffect.affectors.push_back(Affector::gravity(acceleration));
+    gParticleEffectDefined = true;
+    return 0;
+}
+
+int lua_addDrag(lua_State* L) {
+    gParticleEffect.affectors.push_back(Affector::drag(lua_tonumber(L, 1)));
+    gParticleEffectDefined = true;
+    return 0;
+}
+
+int lua_addWind(lua_State* L) {
+    glm::vec3 velocity(lua_tonumber(L, 1), lua_tonumber(L, 2), lua_tonumber(L, 3));
+    gParticleEffect.affectors.push_back(Affector::wind(velocity, lua_tonumber(L, 4)));
+    gParticleEffectDefined = true;
+    return 0;
+}
+
+int lua_addVortex(lua_State* L) {
+    // Swirl around the vertical axis through the given point
+    glm::vec3 center(lua_tonumber(L, 1), lua_tonumber(L, 2), lua_tonumber(L, 3));
+    gParticleEffect.affectors.push_back(Affector::vortex(center, glm::vec3(0.0f, 1.0f, 0.0f), lua_tonumber(L, 4)));
+    gParticleEffectDefined = true;
+    return 0;
+}
+
+int lua_setColorOverLife(lua_State* L) {
+    glm::vec3 startColor(lua_tonumber(L, 1), lua_tonumber(L, 2), lua_tonumber(L, 3));
+    glm::vec3 endColor(lua_tonumber(L, 4), lua_tonumber(L, 5), lua_tonumber(L, 6));
+    gParticleEffect.affectors.push_back(Affector::colorOverLife(startColor, endColor));
+    gParticleEffectDefined = true;
+    return 0;
+}
+
+// Sphere physics set by the script, applied like the particle effect
+PhysicsSettings gPhysicsSettings;
+bool gPhysicsSettingsDefined = false;
+
+int lua_setGravity(lua_State* L) {
+    gPhysicsSettings.gravity = glm::vec3(lua_tonumber(L, 1), lua_tonumber(L, 2), lua_tonumber(L, 3));
+    gPhysicsSettingsDefined = true;
+    return 0;
+}
+
+int lua_setDrag(lua_State* L) {
+    gPhysicsSettings.linearDrag = lua_tonumber(L, 1);   // Per second
+    gPhysicsSettingsDefined = true;
+    return 0;
+}
+
+int lua_setRestitution(lua_State* L) {
+    gPhysicsSettings.contacts.restitution = lua_tonumber(L, 1);     // 0 sticks, 1 elastic
+    gPhysicsSettingsDefined = true;
+    return 0;
+}
+
+int lua_setSolverIterations(lua_State* L) {
+    gPhysicsSettings.contacts.iterations = static_cast<int>(lua_tointeger(L, 1));
+    gPhysicsSettingsDefined = true;
+    return 0;
+}
+
+int lua_setEventDriven(lua_State* L) {
+    // Exact elastic collisions instead of fixed steps, only without gravity, drag or joints
+    gPhysicsSettings.mode = lua_toboolean(L, 1) ? SimulationMode::EventDriven : SimulationMode::FixedStep;
+    gPhysicsSettingsDefined = true;
+    return 0;
+}
+
+// Particle budget shares, applied to the world's boxes by index
+std::vector<float> gParticlePriorities;
+
+int lua_setParticlePriority(lua_State* L) {
+    lua_Integer box = lua_tointeger(L, 1);
+    if (box < 0) return 0;
+    if (static_cast<size_t>(box) >= gParticlePriorities.size()) {
+        gParticlePriorities.resize(static_cast<size_t>(box) + 1, 1.0f);
+    }
+    gParticlePriorities[static_cast<size_t>(box)] = static_cast<float>(lua_tonumber(L, 2));
+    return 0;
+}
+
+// Starts a fresh effect and physics before the script runs, so a reload replaces them
+void resetScriptSettings() {
+    gParticleEffect = ParticleEffect();
+    gParticleEffectDefined = false;
+    gPhysicsSettings = PhysicsSettings();
+    gPhysicsSettingsDefined = false;
+    gParticlePriorities.clear();
+}
+
+
+// Register functions in Lua
+void registerLuaFunctions(lua_State* L) {
+    lua_register(L, "createEntity", lua_createEntity);
+    lua_register(L, "setPosition", lua_setPosition);
+    lua_register(L, "setVelocity", lua_setVelocity);
+    lua_register(L, "setColor", lua_setColor);
+
+    lua_register(L, "setEmitter", lua_setEmitter);
+    lua_register(L, "addGravity", lua_addGravity);
+    lua_register(L, "addDrag", lua_addDrag);
+    lua_register(L, "addWind", lua_addWind);
+    lua_register(L, "addVortex", lua_addVortex);
+    lua_register(L, "setColorOverLife", lua_setColorOverLife);
+    lua_register(L, "setParticlePriority", lua_setParticlePriority);
+
+    lua_register(L, "setGravity", lua_setGravity);
+    lua_register(L, "setDrag", lua_setDrag);
+    lua_register(L, "setRestitution", lua_setRestitution);
+    lua_register(L, "setSolverIterations", lua_setSolverIterations);
+    lua_register(L, "setEventDriven", lua_setEventDriven);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "ComponentManager.h"
+#include "ParticleEffect.h"
+#include "SystemManager.h"
+#include <vector>
+
+//Lua includes
+extern "C"
+{
+#include "lua54/include/lua.h"
+#include "lua54/include/lauxlib.h"
+#include "lua54/include/lualib.h"
+}
+
+// Entities created by the script. Those with a position become spheres in the world.
+extern ComponentArrays gComponents;
+
+// Particle effect built by the script, applied to the world after each load
+extern ParticleEffect gParticleEffect;
+extern bool gParticleEffectDefined;
+
+// Sphere physics set by the script, applied like the particle effect
+extern PhysicsSettings gPhysicsSettings;
+extern bool gPhysicsSettingsDefined;
+
+// Particle budget priority per box index set by the script, 1 for boxes it skipped
+extern std::vector<float> gParticlePriorities;
+
+// Starts a fresh effect and physics before the script runs, so a reload replaces them
+void resetScriptSettings();
+
+// Register functions in Lua
+void registerLuaFunctions(lua_State* L);
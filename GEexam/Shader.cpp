@@ -1,7 +1,26 @@
 #include "Shader.h"
 
+// Variant defines have to go after the #version line
+static void injectDefines(std::string& code, const std::string& defines)
+{
+    if (defines.empty())
+        return;
+
+    size_t versionPos = code.find("#version");
+    size_t insertPos = 0;
+    if (versionPos != std::string::npos) {
+        size_t lineEnd = code.find('\n', versionPos);
+        insertPos = (lineEnd == std::string::npos) ? code.size() : lineEnd + 1;
+    }
+    code.insert(insertPos, defines);
+}
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
+    : Shader(vertexPath, fragmentPath, std::string())
+{
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines)
 {
 
 
@@ -36,6 +55,9 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
     }
+    injectDefines(vertexCode, defines);
+    injectDefines(fragmentCode, defines);
+
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
 
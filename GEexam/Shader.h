@@ -21,6 +21,8 @@ public:
 
 
 	Shader(const char* vertexPath, const char* fragmentPath);
+	// Builds a variant of the same sources with extra #define lines, e.g. "#define INSTANCED\n"
+	Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines);
 
 	void use();
 	void setBool(const std::string& name, bool value) const;
@@ -0,0 +1,139 @@
+// Headless simulation throughput. Builds a World from a scene file or a Lua script, steps
+// it as fast as it goes without a window or GL context and prints the rates:
+//
+//   SimRunner <scene.txt | script.lua> [frames] [step]
+//
+// steps/s counts World::update() calls, entity steps/s multiplies in the spheres and
+// particles alive at each step. System times are CPU ms per step summed over threads,
+// total is wall time. Lua scripts need a build with SIMRUNNER_LUA, they get the windowed
+// app's default box.
+//
+// Scene files are described in SceneLoader.h.
+#include "World.h"
+#include "SceneLoader.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <memory>
+
+#ifdef SIMRUNNER_LUA
+#include "ScriptBindings.h"
+#endif
+
+const size_t DEFAULT_FRAMES = 1000;
+const float DEFAULT_STEP = 1.0f / 60.0f;
+
+// Accumulated over the run
+struct RunTotals {
+    double wallMs = 0.0;
+    double entitySteps = 0.0;
+    WorldUpdateTimings sum;
+};
+
+static bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+#ifdef SIMRUNNER_LUA
+// Same setup as the windowed app: one box, a unit sphere per positioned entity
+static std::unique_ptr<World> loadScript(const char* path) {
+    auto world = std::make_unique<World>();
+    world->setHeadless(true);
+    world->addBox(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(50.0f, 10.0f, 50.0f));
+
+    lua_State* L = luaL_newstate();
+    luaL_openlibs(L);
+    registerLuaFunctions(L);
+    resetScriptSettings();
+    bool loaded = luaL_dofile(L, path) == LUA_OK;
+    if (!loaded) {
+        std::fprintf(stderr, "Error loading Lua script: %s\n", lua_tostring(L, -1));
+    }
+    lua_close(L);
+    if (!loaded) return nullptr;
+
+    if (gParticleEffectDefined) world->setParticleEffect(gParticleEffect);
+    if (gPhysicsSettingsDefined) world->setPhysicsSettings(gPhysicsSettings);
+    for (size_t box = 0; box < gParticlePriorities.size(); ++box) {
+        world->setParticlePriority(box, gParticlePriorities[box]);
+    }
+    for (size_t i = 0; i < gComponents.transforms.size(); ++i) {
+        if (gComponents.transforms[i].position != glm::vec3(0.0f)) {
+            world->createSphereEntity(gComponents.transforms[i].position, gComponents.physics[i].velocity, 1.0f,
+                gComponents.renders[i].color);
+        }
+    }
+    return world;
+}
+#endif
+
+static void accumulate(WorldUpdateTimings& sum, const WorldUpdateTimings& step) {
+    sum.totalMs += step.totalMs;
+    sum.particleMs += step.particleMs;
+    sum.spheres.jointMs += step.spheres.jointMs;
+    sum.spheres.integrateMs += step.spheres.integrateMs;
+    sum.spheres.gridMs += step.spheres.gridMs;
+    sum.spheres.contactMs += step.spheres.contactMs;
+    sum.spheres.eventMs += step.spheres.eventMs;
+    sum.particles.updateMs += step.particles.updateMs;
+    sum.particles.spawnMs += step.particles.spawnMs;
+    sum.particles.uploadMs += step.particles.uploadMs;
+    sum.sphereCount += step.sphereCount;
+    sum.particleCount += step.particleCount;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: SimRunner <scene.txt | script.lua> [frames] [step]\n");
+        return 1;
+    }
+    const char* path = argv[1];
+    size_t frames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DEFAULT_FRAMES;
+    float step = argc > 3 ? static_cast<float>(std::atof(argv[3])) : DEFAULT_STEP;
+
+    std::unique_ptr<World> world;
+    if (endsWith(path, ".lua")) {
+#ifdef SIMRUNNER_LUA
+        world = loadScript(path);
+#else
+        std::fprintf(stderr, "Built without Lua, can't run %s\n", path);
+#endif
+    }
+    else {
+        world = loadScene(path);
+    }
+    if (!world) return 1;
+
+    RunTotals totals;
+    for (size_t frame = 0; frame < frames; ++frame) {
+        auto start = std::chrono::steady_clock::now();
+        world->update(step);
+        totals.wallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        const WorldUpdateTimings& timings = world->getLastUpdateTimings();
+        accumulate(totals.sum, timings);
+        totals.entitySteps += static_cast<double>(timings.sphereCount + timings.particleCount);
+    }
+
+    const WorldUpdateTimings& last = world->getLastUpdateTimings();
+    const double seconds = totals.wallMs / 1000.0;
+    const double perStep = frames > 0 ? 1.0 / frames : 0.0;
+    std::printf("scene %s\n", path);
+    std::printf("frames %zu  step %.4f s  spheres %zu  particles %zu\n", frames, step, last.sphereCount, last.particleCount);
+    std::printf("wall %.3f s  steps/s %.1f  entity steps/s %.4g\n", seconds,
+        seconds > 0.0 ? frames / seconds : 0.0, seconds > 0.0 ? totals.entitySteps / seconds : 0.0);
+
+    const WorldUpdateTimings& sum = totals.sum;
+    std::printf("ms per step:\n");
+    std::printf("  joints     %8.4f\n", sum.spheres.jointMs * perStep);
+    std::printf("  integrate  %8.4f\n", sum.spheres.integrateMs * perStep);
+    std::printf("  grid       %8.4f\n", sum.spheres.gridMs * perStep);
+    std::printf("  contacts   %8.4f\n", sum.spheres.contactMs * perStep);
+    std::printf("  events     %8.4f\n", sum.spheres.eventMs * perStep);
+    std::printf("  particles  %8.4f  (update %.4f  spawn %.4f  upload %.4f)\n", sum.particleMs * perStep,
+        sum.particles.updateMs * perStep, sum.particles.spawnMs * perStep, sum.particles.uploadMs * perStep);
+    std::printf("  total      %8.4f\n", sum.totalMs * perStep);
+    std::printf("state hash %016llx\n", static_cast<unsigned long long>(world->computeStateHash()));
+    return 0;
+}
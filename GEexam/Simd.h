@@ -0,0 +1,72 @@
+#pragma once
+
+// SIMD feature detection for the batch systems.
+// MSVC x64 always has SSE2, /arch:AVX or /arch:AVX2 defines __AVX__.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GE_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#define GE_SIMD_AVX 1
+#include <immintrin.h>
+#endif
+
+// One float behind the SimdFloat interface: the fallback on builds without SSE, and
+// the scalar variant benchmarks compare against.
+struct ScalarFloat {
+    static constexpr int WIDTH = 1;
+    float v;
+
+    static ScalarFloat load(const float* p) { return { *p }; }
+    static ScalarFloat set(float x) { return { x }; }
+    void store(float* p) const { *p = v; }
+    int mask() const { return v != 0.0f ? 1 : 0; }
+
+    friend ScalarFloat operator+(ScalarFloat a, ScalarFloat b) { return { a.v + b.v }; }
+    friend ScalarFloat operator-(ScalarFloat a, ScalarFloat b) { return { a.v - b.v }; }
+    friend ScalarFloat operator*(ScalarFloat a, ScalarFloat b) { return { a.v * b.v }; }
+    friend ScalarFloat operator/(ScalarFloat a, ScalarFloat b) { return { a.v / b.v }; }
+    friend ScalarFloat operator|(ScalarFloat a, ScalarFloat b) { return { (a.v != 0.0f || b.v != 0.0f) ? 1.0f : 0.0f }; }
+    friend ScalarFloat lessEqual(ScalarFloat a, ScalarFloat b) { return { a.v <= b.v ? 1.0f : 0.0f }; }
+};
+
+// Float lanes at the widest available width, so a kernel can be written once.
+// Compare results are lane masks, combined with | and read back with mask().
+#if defined(GE_SIMD_AVX)
+struct SimdFloat {
+    static constexpr int WIDTH = 8;
+    __m256 v;
+
+    static SimdFloat load(const float* p) { return { _mm256_loadu_ps(p) }; }
+    static SimdFloat set(float x) { return { _mm256_set1_ps(x) }; }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+    int mask() const { return _mm256_movemask_ps(v); }
+
+    friend SimdFloat operator+(SimdFloat a, SimdFloat b) { return { _mm256_add_ps(a.v, b.v) }; }
+    friend SimdFloat operator-(SimdFloat a, SimdFloat b) { return { _mm256_sub_ps(a.v, b.v) }; }
+    friend SimdFloat operator*(SimdFloat a, SimdFloat b) { return { _mm256_mul_ps(a.v, b.v) }; }
+    friend SimdFloat operator/(SimdFloat a, SimdFloat b) { return { _mm256_div_ps(a.v, b.v) }; }
+    friend SimdFloat operator|(SimdFloat a, SimdFloat b) { return { _mm256_or_ps(a.v, b.v) }; }
+    friend SimdFloat lessEqual(SimdFloat a, SimdFloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+};
+#elif defined(GE_SIMD_SSE)
+struct SimdFloat {
+    static constexpr int WIDTH = 4;
+    __m128 v;
+
+    static SimdFloat load(const float* p) { return { _mm_loadu_ps(p) }; }
+    static SimdFloat set(float x) { return { _mm_set1_ps(x) }; }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+    int mask() const { return _mm_movemask_ps(v); }
+
+    friend SimdFloat operator+(SimdFloat a, SimdFloat b) { return { _mm_add_ps(a.v, b.v) }; }
+    friend SimdFloat operator-(SimdFloat a, SimdFloat b) { return { _mm_sub_ps(a.v, b.v) }; }
+    friend SimdFloat operator*(SimdFloat a, SimdFloat b) { return { _mm_mul_ps(a.v, b.v) }; }
+    friend SimdFloat operator/(SimdFloat a, SimdFloat b) { return { _mm_div_ps(a.v, b.v) }; }
+    friend SimdFloat operator|(SimdFloat a, SimdFloat b) { return { _mm_or_ps(a.v, b.v) }; }
+    friend SimdFloat lessEqual(SimdFloat a, SimdFloat b) { return { _mm_cmple_ps(a.v, b.v) }; }
+};
+#else
+using SimdFloat = ScalarFloat;
+#endif
@@ -0,0 +1,57 @@
+#include "SimulationThread.h"
+#include <future>
+
+void SimulationThread::start(Command afterBatch) {
+    if (isRunning()) return;
+    mAfterBatch = std::move(afterBatch);
+    mStopping = false;
+    mThread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    if (!isRunning()) return;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_one();
+    mThread.join();
+}
+
+void SimulationThread::post(Command command) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back(std::move(command));
+    }
+    mWake.notify_one();
+}
+
+void SimulationThread::call(const Command& command) {
+    std::promise<void> done;
+    std::future<void> finished = done.get_future();
+    post([&] {
+        command();
+        done.set_value();
+    });
+    finished.wait();
+}
+
+void SimulationThread::run() {
+    // Swapped with the queue, so both keep their storage
+    std::vector<Command> batch;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+            if (mQueue.empty()) return;
+            batch.swap(mQueue);
+        }
+
+        for (Command& command : batch) {
+            command();
+        }
+        batch.clear();
+
+        if (mAfterBatch) mAfterBatch();
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// One thread that runs queued commands in order, so the simulation can run beside the
+// GL thread. It takes everything queued so far as a batch, runs it and then calls the
+// batch callback, where World publishes its render frame.
+class SimulationThread {
+public:
+    using Command = std::function<void()>;
+
+    SimulationThread() = default;
+    ~SimulationThread() { stop(); }
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    void start(Command afterBatch);
+
+    // Runs whatever is still queued, then joins
+    void stop();
+
+    bool isRunning() const { return mThread.joinable(); }
+
+    void post(Command command);
+
+    // Queues command and waits until it has run. Not to be called from the thread itself.
+    void call(const Command& command);
+
+private:
+    void run();
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::vector<Command> mQueue;
+    Command mAfterBatch;
+    bool mStopping = false;
+};
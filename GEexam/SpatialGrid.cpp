@@ -0,0 +1,134 @@
+#include "SpatialGrid.h"
+#include "Simd.h"
+#include <algorithm>
+
+void SpatialGrid::build(const ComponentArrays& components, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    const size_t sphereCount = components.physics.size();
+
+    // Cells at least as wide as the largest sphere, so one sphere covers at most 2x2x2 cells
+    float maxRadius = 0.0f;
+    for (const PhysicsComponent& physics : components.physics) {
+        maxRadius = std::max(maxRadius, physics.radius);
+    }
+    glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-3f));
+    float cellSize = std::max(2.0f * maxRadius, std::max(extent.x, std::max(extent.y, extent.z)) / MAX_CELLS_PER_AXIS);
+    cellSize = std::max(cellSize, 1e-3f);
+
+    mOrigin = boundsMin;
+    mInvCellSize = 1.0f / cellSize;
+    mDims = glm::clamp(glm::ivec3(glm::ceil(extent * mInvCellSize)), glm::ivec3(1), glm::ivec3(MAX_CELLS_PER_AXIS));
+
+    const int cellCount = mDims.x * mDims.y * mDims.z;
+    mCellStart.assign(cellCount + 1, 0);
+
+    // Count, prefix sum, fill
+    for (size_t i = 0; i < sphereCount; ++i) {
+        const glm::vec3& center = components.transforms[i].position;
+        float radius = components.physics[i].radius;
+        glm::ivec3 lo = cellCoords(center - radius);
+        glm::ivec3 hi = cellCoords(center + radius);
+        for (int z = lo.z; z <= hi.z; ++z)
+            for (int y = lo.y; y <= hi.y; ++y)
+                for (int x = lo.x; x <= hi.x; ++x)
+                    mCellStart[cellIndex(glm::ivec3(x, y, z)) + 1]++;
+    }
+    mOccupiedIndex.assign(cellCount, -1);
+    mOccupied.clear();
+    for (int cell = 0; cell < cellCount; ++cell) {
+        if (mCellStart[cell + 1] != 0) {
+            mOccupiedIndex[cell] = static_cast<int>(mOccupied.size());
+            mOccupied.push_back(static_cast<uint32_t>(cell));
+        }
+        mCellStart[cell + 1] += mCellStart[cell];
+    }
+
+    const uint32_t entryCount = mCellStart[cellCount];
+    mEntities.resize(entryCount);
+    mX.resize(entryCount);
+    mY.resize(entryCount);
+    mZ.resize(entryCount);
+    mRadius.resize(entryCount);
+    mCellFill.assign(mCellStart.begin(), mCellStart.end() - 1);
+
+    for (size_t i = 0; i < sphereCount; ++i) {
+        const glm::vec3& center = components.transforms[i].position;
+        float radius = components.physics[i].radius;
+        glm::ivec3 lo = cellCoords(center - radius);
+        glm::ivec3 hi = cellCoords(center + radius);
+        for (int z = lo.z; z <= hi.z; ++z)
+            for (int y = lo.y; y <= hi.y; ++y)
+                for (int x = lo.x; x <= hi.x; ++x) {
+                    uint32_t slot = mCellFill[cellIndex(glm::ivec3(x, y, z))]++;
+                    mEntities[slot] = static_cast<uint32_t>(i);
+                    mX[slot] = center.x;
+                    mY[slot] = center.y;
+                    mZ[slot] = center.z;
+                    mRadius[slot] = radius;
+                }
+    }
+}
+
+glm::ivec3 SpatialGrid::cellCoords(const glm::vec3& point) const {
+    // Anything outside the bounds is clamped into the border cells
+    glm::ivec3 coords = glm::ivec3(glm::floor((point - mOrigin) * mInvCellSize));
+    return glm::clamp(coords, glm::ivec3(0), mDims - 1);
+}
+
+int SpatialGrid::findOccupiedCell(float x, float y, float z) const {
+    if (mEntities.empty()) return -1;
+
+    glm::vec3 local = (glm::vec3(x, y, z) - mOrigin) * mInvCellSize;
+    if (local.x < 0.0f || local.y < 0.0f || local.z < 0.0f) return -1;
+
+    glm::ivec3 coords = glm::ivec3(local);
+    if (coords.x >= mDims.x || coords.y >= mDims.y || coords.z >= mDims.z) return -1;
+
+    return mOccupiedIndex[cellIndex(coords)];
+}
+
+void SpatialGrid::findOccupiedCells(const float* x, const float* y, const float* z, size_t count, int* outCells) const {
+    size_t i = 0;
+    if (mEntities.empty()) {
+        std::fill(outCells, outCells + count, -1);
+        return;
+    }
+
+#if defined(GE_SIMD_SSE)
+    const __m128 originX = _mm_set1_ps(mOrigin.x);
+    const __m128 originY = _mm_set1_ps(mOrigin.y);
+    const __m128 originZ = _mm_set1_ps(mOrigin.z);
+    const __m128 invCellSize = _mm_set1_ps(mInvCellSize);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 dimX = _mm_set1_ps(static_cast<float>(mDims.x));
+    const __m128 dimY = _mm_set1_ps(static_cast<float>(mDims.y));
+    const __m128 dimZ = _mm_set1_ps(static_cast<float>(mDims.z));
+    alignas(16) int cells[4];
+    for (; i + 4 <= count; i += 4) {
+        __m128 lx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i), originX), invCellSize);
+        __m128 ly = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(y + i), originY), invCellSize);
+        __m128 lz = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(z + i), originZ), invCellSize);
+
+        // Inside when 0 <= local < dims on every axis
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(lx, zero), _mm_cmplt_ps(lx, dimX)),
+            _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(ly, zero), _mm_cmplt_ps(ly, dimY)),
+                _mm_and_ps(_mm_cmpge_ps(lz, zero), _mm_cmplt_ps(lz, dimZ))));
+
+        // Linear index in float is exact for grids up to MAX_CELLS_PER_AXIS^3
+        __m128 fx = _mm_cvtepi32_ps(_mm_cvttps_epi32(lx));
+        __m128 fy = _mm_cvtepi32_ps(_mm_cvttps_epi32(ly));
+        __m128 fz = _mm_cvtepi32_ps(_mm_cvttps_epi32(lz));
+        __m128 linear = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(fz, dimY), fy), dimX), fx);
+        __m128i index = _mm_and_si128(_mm_cvttps_epi32(linear), _mm_castps_si128(inside));
+        _mm_store_si128(reinterpret_cast<__m128i*>(cells), index);
+
+        int insideMask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; ++lane) {
+            outCells[i + lane] = (insideMask & (1 << lane)) ? mOccupiedIndex[cells[lane]] : -1;
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        outCells[i] = findOccupiedCell(x[i], y[i], z[i]);
+    }
+}
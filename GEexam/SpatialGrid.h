@@ -0,0 +1,77 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "ComponentManager.h"
+
+// Uniform grid over the sphere components, rebuilt every frame with a counting sort.
+// A sphere is stored in every cell its bounds overlap, so a point only has to look at
+// its own cell. Cell entries are kept SoA so one cell can be tested as a batch.
+class SpatialGrid {
+public:
+    static constexpr int MAX_CELLS_PER_AXIS = 32;
+
+    void build(const ComponentArrays& components, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    // Occupied cells are numbered 0..getOccupiedCount()-1 so callers can bin into them
+    // with a small counting sort. Returns the occupied cell holding the point, or -1
+    // when the point is outside the grid or its cell holds no sphere.
+    int findOccupiedCell(float x, float y, float z) const;
+    size_t getOccupiedCount() const { return mOccupied.size(); }
+
+    // findOccupiedCell for count points from SoA streams, 4 at a time
+    void findOccupiedCells(const float* x, const float* y, const float* z, size_t count, int* outCells) const;
+
+    // Entries of an occupied cell are [getCellBegin(cell), getCellEnd(cell)) of the arrays below
+    uint32_t getCellBegin(int occupied) const { return mCellStart[mOccupied[occupied]]; }
+    uint32_t getCellEnd(int occupied) const { return mCellStart[mOccupied[occupied] + 1]; }
+
+    const float* getX() const { return mX.data(); }
+    const float* getY() const { return mY.data(); }
+    const float* getZ() const { return mZ.data(); }
+    const float* getRadius() const { return mRadius.data(); }
+    const uint32_t* getEntities() const { return mEntities.data(); }
+
+    bool isEmpty() const { return mEntities.empty(); }
+
+    // Calls visit(entityA, entityB) once for every pair of spheres sharing a cell
+    template <typename Visit>
+    void forEachPair(Visit&& visit) const;
+
+private:
+    glm::ivec3 cellCoords(const glm::vec3& point) const;
+    int cellIndex(const glm::ivec3& coords) const { return (coords.z * mDims.y + coords.y) * mDims.x + coords.x; }
+
+    glm::vec3 mOrigin{ 0.0f };
+    float mInvCellSize = 1.0f;
+    glm::ivec3 mDims{ 0 };
+
+    std::vector<uint32_t> mCellStart;   // Cell count + 1 offsets
+    std::vector<uint32_t> mCellFill;    // Build scratch
+    std::vector<int> mOccupiedIndex;    // Per cell, -1 when empty
+    std::vector<uint32_t> mOccupied;    // Cell of each occupied index
+    std::vector<uint32_t> mEntities;
+    std::vector<float> mX, mY, mZ, mRadius;
+};
+
+template <typename Visit>
+void SpatialGrid::forEachPair(Visit&& visit) const {
+    for (uint32_t cell : mOccupied) {
+        const uint32_t begin = mCellStart[cell];
+        const uint32_t end = mCellStart[cell + 1];
+        for (uint32_t a = begin; a < end; ++a) {
+            for (uint32_t b = a + 1; b < end; ++b) {
+                // A pair can share several cells; only the one holding the min corner of
+                // the overlap of their bounds reports it
+                glm::vec3 overlapMin(
+                    std::max(mX[a] - mRadius[a], mX[b] - mRadius[b]),
+                    std::max(mY[a] - mRadius[a], mY[b] - mRadius[b]),
+                    std::max(mZ[a] - mRadius[a], mZ[b] - mRadius[b]));
+                if (cellIndex(cellCoords(overlapMin)) != static_cast<int>(cell)) continue;
+
+                visit(mEntities[a], mEntities[b]);
+            }
+        }
+    }
+}
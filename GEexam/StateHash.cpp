@@ -0,0 +1,37 @@
+#include "StateHash.h"
+#include <cstring>
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 29;
+    return x;
+}
+
+void StateHash::add(const void* data, size_t bytes) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    mLength += bytes;
+
+    // Whole 8-byte words, then the tail zero-padded into one more
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, 8);
+        mState = (mState ^ mix64(word)) * 0x9E3779B97F4A7C15ULL;
+        mState = (mState << 27) | (mState >> 37);
+    }
+    if (i < bytes) {
+        uint64_t word = 0;
+        std::memcpy(&word, p + i, bytes - i);
+        mState = (mState ^ mix64(word)) * 0x9E3779B97F4A7C15ULL;
+        mState = (mState << 27) | (mState >> 37);
+    }
+}
+
+uint64_t StateHash::get() const {
+    // splitmix64 finalizer, the length keeps prefixes of zeros apart
+    uint64_t x = mState ^ mLength;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
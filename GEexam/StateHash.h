@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// 64-bit hash of simulation state, fed in a fixed order. Floats hash by bit pattern,
+// so two runs give the same hash only if every value is bit-identical.
+class StateHash {
+public:
+    void add(const void* data, size_t bytes);
+    void add(uint64_t value) { add(&value, sizeof(value)); }
+
+    template <typename T>
+    void addArray(const std::vector<T>& values, size_t count) { add(values.data(), count * sizeof(T)); }
+
+    uint64_t get() const;
+
+private:
+    uint64_t mState = 0x9E3779B97F4A7C15ULL;
+    uint64_t mLength = 0;
+};
+
+// Hash of one World::update, recorded every N updates in deterministic runs
+struct StateHashRecord {
+    uint64_t frame;
+    uint64_t hash;
+};
@@ -0,0 +1,96 @@
+#include "StreamingBuffer.h"
+#include <cstring>
+
+// Not part of the 3.3 glad loader
+#define GE_GL_MAP_PERSISTENT_BIT 0x0040
+#define GE_GL_MAP_COHERENT_BIT 0x0080
+typedef void (APIENTRYP PFNGEBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+static PFNGEBUFFERSTORAGEPROC sBufferStorage = nullptr;
+
+static bool hasBufferStorage() {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 4)) {
+        return true;
+    }
+
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; ++i) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (name && std::strcmp(name, "GL_ARB_buffer_storage") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void StreamingBuffer::loadExtensions(GLADloadproc load) {
+    sBufferStorage = hasBufferStorage() ? reinterpret_cast<PFNGEBUFFERSTORAGEPROC>(load("glBufferStorage")) : nullptr;
+}
+
+void StreamingBuffer::create(size_t regionSize) {
+    mRegionSize = regionSize;
+    glGenBuffers(1, &mBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+
+    if (sBufferStorage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GE_GL_MAP_PERSISTENT_BIT | GE_GL_MAP_COHERENT_BIT;
+        GLsizeiptr totalSize = static_cast<GLsizeiptr>(regionSize * REGION_COUNT);
+        sBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+        mMapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags));
+    }
+
+    if (!mMapped) {
+        glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+        mStaging.resize(regionSize);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void* StreamingBuffer::beginWrite() {
+    if (!mMapped) {
+        return mStaging.data();
+    }
+
+    // Wait until the GPU is done with the draw that last read this region
+    GLsync& fence = mFences[mRegion];
+    if (fence) {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    return mMapped + mRegion * mRegionSize;
+}
+
+void StreamingBuffer::endWrite(size_t bytesWritten) {
+    if (!mMapped) {
+        // Orphan so the driver can hand out fresh storage instead of stalling on the last draw
+        glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+        glBufferData(GL_ARRAY_BUFFER, mRegionSize, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytesWritten, mStaging.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        mDrawOffset = 0;
+        return;
+    }
+
+    // Coherent mapping: the writes are visible to the next draw without a flush
+    mDrawRegion = mRegion;
+    mDrawOffset = mRegion * mRegionSize;
+    mRegion = (mRegion + 1) % REGION_COUNT;
+}
+
+void StreamingBuffer::fenceDrawnRegion() {
+    if (!mMapped) return;
+
+    GLsync& fence = mFences[mDrawRegion];
+    if (fence) {
+        glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
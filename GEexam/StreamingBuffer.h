@@ -0,0 +1,40 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include <cstddef>
+
+// Per-frame vertex stream split into REGION_COUNT regions.
+// With GL 4.4 / ARB_buffer_storage the buffer is persistently and coherently mapped and
+// every region is fenced until the GPU has drawn from it. Otherwise each write orphans
+// the buffer with glBufferData(nullptr) and uploads from a CPU staging copy.
+class StreamingBuffer {
+public:
+    static constexpr int REGION_COUNT = 3;
+
+    // Looks up glBufferStorage if the context has it; call once after gladLoadGLLoader
+    static void loadExtensions(GLADloadproc load);
+
+    void create(size_t regionSize);
+
+    // Returns memory for this frame's data, regionSize bytes long
+    void* beginWrite();
+    void endWrite(size_t bytesWritten);
+
+    // Call right after the draw that reads the last written region
+    void fenceDrawnRegion();
+
+    GLuint getBuffer() const { return mBuffer; }
+    size_t getDrawOffset() const { return mDrawOffset; }
+    bool isPersistent() const { return mMapped != nullptr; }
+
+private:
+    GLuint mBuffer = 0;
+    size_t mRegionSize = 0;
+    int mRegion = 0;
+    int mDrawRegion = 0;
+    size_t mDrawOffset = 0;
+
+    unsigned char* mMapped = nullptr;
+    GLsync mFences[REGION_COUNT] = {};
+    std::vector<unsigned char> mStaging;
+};
@@ -1,116 +1,484 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
 #include <glm/gtc/matrix_transform.hpp>
 #include "Shader.h"
 #include "EntityManager.h"
 #include "ComponentManager.h"
+#include "Simd.h"
+#include "RenderView.h"
+#include "RenderQueue.h"
+#include "ThreadPool.h"
+#include "ContactSolver.h"
 
 
-class CollisionSystem {
+// Scene lighting shared by every shader variant
+inline void applySceneLighting(const Shader& shader) {
+    shader.setVec3("lightPos", glm::vec3(0.0f, 20.0f, 0.0f));
+    shader.setVec3("viewPos", glm::vec3(0.0f, 5.0f, 10.0f));
+    shader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
+}
+
+
+
+enum class Integrator {
+    SemiImplicitEuler,  // v' = v + a dt, then x += v' dt
+    VelocityVerlet      // x' = x + v dt + a dt^2 / 2, v' = v + (a + a') dt / 2
+};                      // Springs are solved implicitly by JointSolver before either
+
+enum class SimulationMode {
+    FixedStep,      // Sub-stepped integration with the contact solver
+    EventDriven     // Exact elastic collisions, from event to event, see EventSimulation
+};
+
+// Integration settings, one set per world
+struct PhysicsSettings {
+    Integrator integrator = Integrator::SemiImplicitEuler;
+    glm::vec3 gravity{ 0.0f };
+    float linearDrag = 0.0f;    // Per second, applied implicitly so any value is stable
+
+    // Sub-stepping: no sphere moves more than maxTravel of its radius per sub-step,
+    // within maxSubSteps and a ceiling of maxEntitySubSteps (spheres x sub-steps) per update
+    float maxTravel = 0.5f;
+    int maxSubSteps = 8;
+    size_t maxEntitySubSteps = 100000;
+
+    // Restitution and iterations of the contact solver, run once per sub-step
+    ContactSettings contacts;
+
+    // EventDriven needs free flight, so it falls back to FixedStep while there is gravity,
+    // drag or a joint. maxEventsPerUpdate bounds a frame's work; past it the spheres stop
+    // short of the step.
+    SimulationMode mode = SimulationMode::FixedStep;
+    size_t maxEventsPerUpdate = 1000000;
+};
+
+class PhysicsSystem {
 public:
-    static void updateWorldBoundCollisions(
-        ComponentArrays& components,
-        const WorldBoundsComponent& bounds
-    ) {
-        for (size_t i = 0; i < components.physics.size(); ++i) {
-            auto& transform = components.transforms[i];
-            auto& physics = components.physics[i];
-
-            for (int axis = 0; axis < 3; ++axis) {
-                if (transform.position[axis] - physics.radius < bounds.min[axis]) {
-                    transform.position[axis] = bounds.min[axis] + physics.radius;
-                    physics.velocity[axis] = std::abs(physics.velocity[axis]);
-                }
-                else if (transform.position[axis] + physics.radius > bounds.max[axis]) {
-                    transform.position[axis] = bounds.max[axis] - physics.radius;
-                    physics.velocity[axis] = -std::abs(physics.velocity[axis]);
-                }
-            }
+    // Entities per batch. The AoS components are gathered into float lanes, integrated
+    // at SimdFloat width and scattered back.
+    static constexpr size_t BATCH = 8;
+
+    // Kept by the caller between updates, so the scan below doesn't allocate
+    struct Scratch {
+        std::vector<float> blockMax;    // maxSpeedOverRadius, one per SCAN_BLOCK
+    };
+
+    // Applies gravity, drag and the accumulated forces in one pass. clearForces = false
+    // keeps the forces for the following sub-steps of the same update.
+    static void update(ComponentArrays& components, float deltaTime, const PhysicsSettings& settings,
+        bool clearForces = true) {
+        if (settings.integrator == Integrator::VelocityVerlet) {
+            integrateVerlet(components, deltaTime, settings, clearForces);
+            return;
+        }
+
+        const size_t count = components.physics.size();
+        for (size_t begin = 0; begin < count; begin += BATCH) {
+            integrateBatch(components, begin, std::min(count - begin, BATCH), deltaTime, settings, clearForces);
         }
     }
-    static void updateInterEntityCollisions(ComponentArrays& components) {
-        for (size_t i = 0; i < components.physics.size(); ++i) {
-            for (size_t j = i + 1; j < components.physics.size(); ++j) {
-                if (detectCollision(components.transforms[i], components.physics[i],
-                    components.transforms[j], components.physics[j])) {
-                    resolveCollision(components.transforms[i], components.physics[i],
-                        components.transforms[j], components.physics[j]);
-                }
+
+    // Entities per thread pool job when scanning for the fastest sphere
+    static constexpr size_t SCAN_BLOCK = 4096;
+
+    // Largest |velocity| / radius over all entities, in radii per second
+    static float maxSpeedOverRadius(const ComponentArrays& components, Scratch& scratch) {
+        const size_t count = components.physics.size();
+        const size_t blockCount = (count + SCAN_BLOCK - 1) / SCAN_BLOCK;
+        std::vector<float>& blockMax = scratch.blockMax;
+        blockMax.assign(blockCount, 0.0f);
+
+        // Squared ratios per block, one sqrt at the end
+        ThreadPool::shared().parallelFor(blockCount, [&](size_t block) {
+            size_t end = std::min(count, (block + 1) * SCAN_BLOCK);
+            float maxRatioSq = 0.0f;
+            for (size_t i = block * SCAN_BLOCK; i < end; ++i) {
+                const PhysicsComponent& physics = components.physics[i];
+                float radius = std::max(physics.radius, 1e-4f);
+                maxRatioSq = std::max(maxRatioSq, glm::dot(physics.velocity, physics.velocity) / (radius * radius));
             }
+            blockMax[block] = maxRatioSq;
+        });
+
+        float maxRatioSq = 0.0f;
+        for (float value : blockMax) {
+            maxRatioSq = std::max(maxRatioSq, value);
         }
+        return std::sqrt(maxRatioSq);
     }
 
-private:
-    static bool detectCollision(
-        const TransformComponent& transform1, const PhysicsComponent& physics1,
-        const TransformComponent& transform2, const PhysicsComponent& physics2
-    ) {
-        glm::vec3 deltaPos = transform1.position - transform2.position;
-        float distance = glm::length(deltaPos);
-        return distance < (physics1.radius + physics2.radius);
+    // Sub-steps for one update of deltaTime under the settings' travel limit and cost ceiling
+    static int chooseSubSteps(const ComponentArrays& components, float deltaTime, const PhysicsSettings& settings,
+        Scratch& scratch) {
+        const size_t count = components.physics.size();
+        if (count == 0 || settings.maxTravel <= 0.0f) return 1;
+
+        int ceiling = std::max(1, settings.maxSubSteps);
+        if (settings.maxEntitySubSteps > 0) {
+            size_t perEntity = std::max<size_t>(1, settings.maxEntitySubSteps / count);
+            ceiling = static_cast<int>(std::min(static_cast<size_t>(ceiling), perEntity));
+        }
+
+        // Clamped while still a float, a NaN, infinite or huge ratio can't be cast to int.
+        // NaN fails the comparison and takes the ceiling too.
+        float steps = std::ceil(maxSpeedOverRadius(components, scratch) * deltaTime / settings.maxTravel);
+        if (!(steps <= static_cast<float>(ceiling))) return ceiling;
+        return steps < 1.0f ? 1 : static_cast<int>(steps);
     }
 
-    static void resolveCollision(
-        TransformComponent& transform1, PhysicsComponent& physics1,
-        TransformComponent& transform2, PhysicsComponent& physics2
-    ) {
-        glm::vec3 normal = glm::normalize(transform1.position - transform2.position);
-        float m1 = physics1.mass, m2 = physics2.mass;
-        glm::vec3 v1 = physics1.velocity, v2 = physics2.velocity;
+    static void applyForce(ComponentArrays& components, uint32_t entity, const glm::vec3& force) {
+        if (entity < components.forces.size()) {
+            components.forces[entity].force += force;
+        }
+    }
+
+private:
+    static void integrateBatch(ComponentArrays& components, size_t begin, size_t count, float deltaTime,
+        const PhysicsSettings& settings, bool clearForces) {
+        // Gather into lanes, unused lanes repeat the first entity
+        alignas(32) float px[BATCH], py[BATCH], pz[BATCH];
+        alignas(32) float vx[BATCH], vy[BATCH], vz[BATCH];
+        alignas(32) float fx[BATCH], fy[BATCH], fz[BATCH], inverseMass[BATCH];
+        for (size_t lane = 0; lane < BATCH; ++lane) {
+            size_t i = begin + (lane < count ? lane : 0);
+            const glm::vec3& position = components.transforms[i].position;
+            const PhysicsComponent& physics = components.physics[i];
+            const glm::vec3& force = components.forces[i].force;
+            px[lane] = position.x;
+            py[lane] = position.y;
+            pz[lane] = position.z;
+            vx[lane] = physics.velocity.x;
+            vy[lane] = physics.velocity.y;
+            vz[lane] = physics.velocity.z;
+            fx[lane] = force.x;
+            fy[lane] = force.y;
+            fz[lane] = force.z;
+            inverseMass[lane] = physics.mass > 0.0f ? 1.0f / physics.mass : 0.0f;
+        }
+
+        // v' = (v + (g + F / m) dt) / (1 + drag dt)
+        const SimdFloat dt = SimdFloat::set(deltaTime);
+        const SimdFloat damping = SimdFloat::set(1.0f / (1.0f + settings.linearDrag * deltaTime));
+        const SimdFloat gx = SimdFloat::set(settings.gravity.x);
+        const SimdFloat gy = SimdFloat::set(settings.gravity.y);
+        const SimdFloat gz = SimdFloat::set(settings.gravity.z);
+        for (size_t k = 0; k < BATCH; k += SimdFloat::WIDTH) {
+            SimdFloat m = SimdFloat::load(inverseMass + k);
+            SimdFloat newX = (SimdFloat::load(vx + k) + (gx + SimdFloat::load(fx + k) * m) * dt) * damping;
+            SimdFloat newY = (SimdFloat::load(vy + k) + (gy + SimdFloat::load(fy + k) * m) * dt) * damping;
+            SimdFloat newZ = (SimdFloat::load(vz + k) + (gz + SimdFloat::load(fz + k) * m) * dt) * damping;
 
-        float v1n = glm::dot(v1, normal);
-        float v2n = glm::dot(v2, normal);
+            (SimdFloat::load(px + k) + newX * dt).store(px + k);
+            (SimdFloat::load(py + k) + newY * dt).store(py + k);
+            (SimdFloat::load(pz + k) + newZ * dt).store(pz + k);
+            newX.store(vx + k);
+            newY.store(vy + k);
+            newZ.store(vz + k);
+        }
 
-        float v1nPrime = (m1 - m2) / (m1 + m2) * v1n + (2 * m2) / (m1 + m2) * v2n;
-        float v2nPrime = (m2 - m1) / (m1 + m2) * v2n + (2 * m1) / (m1 + m2) * v1n;
+        for (size_t lane = 0; lane < count; ++lane) {
+            size_t i = begin + lane;
+            glm::vec3 position(px[lane], py[lane], pz[lane]);
+            if (position != components.transforms[i].position) {
+                components.transforms[i].position = position;
+                components.transformDirty[i] = 1;
+            }
+            components.physics[i].velocity = glm::vec3(vx[lane], vy[lane], vz[lane]);
+            if (clearForces) components.forces[i].force = glm::vec3(0.0f);
+        }
+    }
 
-        physics1.velocity += (v1nPrime - v1n) * normal;
-        physics2.velocity += (v2nPrime - v2n) * normal;
+    // The springs were solved before the step, so every force left is constant over it and
+    // a' = a: one evaluation serves both halves. Drag is applied implicitly at the end.
+    static void integrateVerlet(ComponentArrays& components, float deltaTime, const PhysicsSettings& settings,
+        bool clearForces) {
+        const size_t count = components.physics.size();
+        const float halfDtSq = 0.5f * deltaTime * deltaTime;
+        const float damping = 1.0f / (1.0f + settings.linearDrag * deltaTime);
+        for (size_t i = 0; i < count; ++i) {
+            float mass = components.physics[i].mass;
+            glm::vec3 a = settings.gravity + components.forces[i].force * (mass > 0.0f ? 1.0f / mass : 0.0f);
+            glm::vec3& velocity = components.physics[i].velocity;
+            glm::vec3 position = components.transforms[i].position + velocity * deltaTime + a * halfDtSq;
+            if (position != components.transforms[i].position) {
+                components.transforms[i].position = position;
+                components.transformDirty[i] = 1;
+            }
+            velocity = (velocity + a * deltaTime) * damping;
+            if (clearForces) components.forces[i].force = glm::vec3(0.0f);
+        }
     }
 };
 
 
 
-class PhysicsSystem {
+class TransformSystem {
 public:
-    static void update(ComponentArrays& components, float deltaTime) {
-        for (size_t i = 0; i < components.physics.size(); ++i) {
-            auto& transform = components.transforms[i];
-            const auto& physics = components.physics[i];
+    // Call before each fixed step. Entities that moved in the last step are flagged, so
+    // their blended matrices get one final rebuild at the position they settled on.
+    static void beginStep(ComponentArrays& components) {
+        for (size_t i = 0; i < components.transforms.size(); ++i) {
+            const glm::vec3& position = components.transforms[i].position;
+            if (components.previousPositions[i] != position) {
+                components.previousPositions[i] = position;
+                components.transformDirty[i] = 1;
+            }
+        }
+    }
+
+    // Position drawn between the last two fixed steps
+    static glm::vec3 renderPosition(const ComponentArrays& components, size_t i, float interpolation) {
+        return glm::mix(components.previousPositions[i], components.transforms[i].position, interpolation);
+    }
+
+    // Rebuilds model and normal matrices, 4 at a time, for dirty entities, those still
+    // moving between steps and those whose colour was changed. Returns how many instances
+    // were rebuilt.
+    static size_t updateInstances(ComponentArrays& components, float interpolation = 1.0f) {
+        uint32_t batch[4];
+        size_t batchSize = 0;
+        size_t rebuilt = 0;
+
+        for (size_t i = 0; i < components.renders.size(); ++i) {
+            if (!components.transformDirty[i] && components.previousPositions[i] == components.transforms[i].position &&
+                components.instances[i].color == components.renders[i].color) continue;
+            components.transformDirty[i] = 0;
+
+            batch[batchSize++] = static_cast<uint32_t>(i);
+            if (batchSize == 4) {
+                buildBatch(components, batch, batchSize, interpolation);
+                rebuilt += batchSize;
+                batchSize = 0;
+            }
+        }
+        if (batchSize > 0) {
+            buildBatch(components, batch, batchSize, interpolation);
+            rebuilt += batchSize;
+        }
+        return rebuilt;
+    }
+
+    static bool isUniformScale(const TransformComponent& transform) {
+        return transform.scale.x == transform.scale.y && transform.scale.y == transform.scale.z;
+    }
+
+private:
+    static void buildBatch(ComponentArrays& components, const uint32_t* batch, size_t count, float interpolation) {
+        // Gather scale * radius per axis into lanes, unused lanes repeat the first entity
+        alignas(16) float sx[4], sy[4], sz[4];
+        alignas(16) float ix[4], iy[4], iz[4];
+        for (size_t lane = 0; lane < 4; ++lane) {
+            uint32_t i = batch[lane < count ? lane : 0];
+            const glm::vec3& scale = components.transforms[i].scale;
+            float radius = components.renders[i].radius;
+            sx[lane] = scale.x * radius;
+            sy[lane] = scale.y * radius;
+            sz[lane] = scale.z * radius;
+        }
 
-            transform.position += physics.velocity * deltaTime;
+        // Normal matrix of T * S is diag(1 / s), so only reciprocals are needed
+#ifdef GE_SIMD_SSE
+        const __m128 one = _mm_set1_ps(1.0f);
+        _mm_store_ps(ix, _mm_div_ps(one, _mm_load_ps(sx)));
+        _mm_store_ps(iy, _mm_div_ps(one, _mm_load_ps(sy)));
+        _mm_store_ps(iz, _mm_div_ps(one, _mm_load_ps(sz)));
+#else
+        for (size_t lane = 0; lane < 4; ++lane) {
+            ix[lane] = 1.0f / sx[lane];
+            iy[lane] = 1.0f / sy[lane];
+            iz[lane] = 1.0f / sz[lane];
+        }
+#endif
+
+        for (size_t lane = 0; lane < count; ++lane) {
+            uint32_t i = batch[lane];
+            glm::vec3 position = renderPosition(components, i, interpolation);
+            InstanceData& instance = components.instances[i];
+
+            instance.model = glm::mat4(
+                glm::vec4(sx[lane], 0.0f, 0.0f, 0.0f),
+                glm::vec4(0.0f, sy[lane], 0.0f, 0.0f),
+                glm::vec4(0.0f, 0.0f, sz[lane], 0.0f),
+                glm::vec4(position, 1.0f));
+            instance.normal = glm::mat3(
+                glm::vec3(ix[lane], 0.0f, 0.0f),
+                glm::vec3(0.0f, iy[lane], 0.0f),
+                glm::vec3(0.0f, 0.0f, iz[lane]));
+            instance.color = components.renders[i].color;
         }
     }
 };
 
 
 
+// One cached sphere mesh level
+struct SphereMesh {
+    uint32_t vao = 0;
+    size_t vertexCount = 0;
+};
+
 class RenderSystem {
 public:
-    void render(ComponentArrays& components, Shader& shader, const glm::mat4& view, const glm::mat4& projection) {
-        for (size_t i = 0; i < components.renders.size(); ++i) {
-            const auto& transform = components.transforms[i];
-            const auto& render = components.renders[i];
+    // LOD 0 is the full subdivision-3 sphere (512 triangles), each level below is a quarter of that
+    static constexpr int LOD_COUNT = 3;
 
-            shader.use();
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, transform.position);
-            model = glm::scale(model, glm::vec3(transform.scale) * render.radius);  // Add radius scaling
+    // Screen radius in pixels above which a sphere uses the finer level, per LOD boundary
+    static constexpr float LOD_THRESHOLDS[LOD_COUNT - 1] = { 48.0f, 16.0f };
+    // Relative band around each threshold that an instance must cross before switching, to avoid popping
+    static constexpr float LOD_HYSTERESIS = 0.15f;
 
-            shader.setMat4("model", model);
-            shader.setMat4("view", view);
-            shader.setMat4("projection", projection);
-            shader.setVec3("objectColor", render.color);
+    // Hooks the instance buffer into a mesh VAO (attribute locations 2-9 in Exam.vs)
+    void attachInstanceBuffer(uint32_t vao) {
+        if (mInstanceVBO == 0) {
+            glGenBuffers(1, &mInstanceVBO);
+        }
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+        for (GLuint location = 2; location <= 9; ++location) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        RenderQueue::bindInstanceAttributes(0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Culls against the frustum, picks a LOD per visible instance, then submits one
+    // instanced draw per (LOD, shader variant) bucket
+    void render(RenderQueue& queue, ComponentArrays& components, const SphereMesh* lods, RenderView& renderView) {
+        TransformSystem::updateInstances(components, renderView.interpolation);
+        cull(components, renderView);
+        selectLods(components, renderView);
+        buildStaging(components, renderView);
+        if (mStaging.empty()) return;
+        upload();
+
+        for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+            size_t count = mBucketOffsets[bucket + 1] - mBucketOffsets[bucket];
+            if (count == 0) continue;
 
-            glBindVertexArray(render.vao);
-            // Use correct number of indices for sphere
-            glDrawArrays(GL_TRIANGLES, 0, render.vertexCount);
-            glBindVertexArray(0);
+            const SphereMesh& mesh = lods[bucket / 2];
+            DrawPacket packet;
+            packet.shader = &instancedShader((bucket % 2) == 0);
+            packet.vao = mesh.vao;
+            packet.count = static_cast<GLsizei>(mesh.vertexCount);
+            packet.instanceCount = static_cast<GLsizei>(count);
+            packet.instanceBuffer = mInstanceVBO;
+            packet.firstInstance = mBucketOffsets[bucket];
+            queue.submit(packet, mBucketDepth[bucket], renderView);
         }
     }
+
+private:
+    // Buckets are ordered (LOD, uniform scale first), index = lod * 2 + (uniform ? 0 : 1)
+    static constexpr int BUCKET_COUNT = LOD_COUNT * 2;
+
+    GLuint mInstanceVBO = 0;
+    size_t mInstanceCapacity = 0;
+    size_t mBucketOffsets[BUCKET_COUNT + 1] = {};
+    float mBucketDepth[BUCKET_COUNT] = {};     // Nearest instance, the bucket's sort depth
+    std::vector<InstanceData> mStaging;
+
+    // SoA bounding-sphere streams for the culling pass
+    std::vector<float> mCullX, mCullY, mCullZ, mCullRadius;
+    std::vector<uint32_t> mVisible;
+    size_t mVisibleCount = 0;
+
+    static Shader& instancedShader(bool uniformScale) {
+        static Shader uniformScaleShader("Exam.vs", "Exam.fs", "#define INSTANCED\n#define UNIFORM_SCALE\n");
+        static Shader generalShader("Exam.vs", "Exam.fs", "#define INSTANCED\n");
+        return uniformScale ? uniformScaleShader : generalShader;
+    }
+
+    void cull(const ComponentArrays& components, RenderView& renderView) {
+        const size_t count = components.renders.size();
+        mCullX.resize(count);
+        mCullY.resize(count);
+        mCullZ.resize(count);
+        mCullRadius.resize(count);
+        mVisible.resize(count);
+
+        for (size_t i = 0; i < count; ++i) {
+            const TransformComponent& transform = components.transforms[i];
+            glm::vec3 position = TransformSystem::renderPosition(components, i, renderView.interpolation);
+            mCullX[i] = position.x;
+            mCullY[i] = position.y;
+            mCullZ[i] = position.z;
+            mCullRadius[i] = components.renders[i].radius *
+                glm::max(transform.scale.x, glm::max(transform.scale.y, transform.scale.z));
+        }
+
+        mVisibleCount = renderView.frustum.cullSpheres(mCullX.data(), mCullY.data(), mCullZ.data(), mCullRadius.data(),
+            count, mVisible.data());
+    }
+
+    // Moves each visible instance at most one level per frame, and only once its
+    // screen radius is clearly past the threshold
+    void selectLods(ComponentArrays& components, const RenderView& renderView) {
+        for (size_t v = 0; v < mVisibleCount; ++v) {
+            uint32_t i = mVisible[v];
+            RenderComponent& render = components.renders[i];
+            float screenRadius = renderView.projectedRadius(
+                glm::vec3(mCullX[i], mCullY[i], mCullZ[i]), mCullRadius[i]);
+
+            int lod = render.lod;
+            if (lod > 0 && screenRadius > LOD_THRESHOLDS[lod - 1] * (1.0f + LOD_HYSTERESIS)) {
+                lod--;
+            }
+            else if (lod < LOD_COUNT - 1 && screenRadius < LOD_THRESHOLDS[lod] * (1.0f - LOD_HYSTERESIS)) {
+                lod++;
+            }
+            render.lod = static_cast<uint8_t>(lod);
+        }
+    }
+
+    static int bucketOf(const ComponentArrays& components, uint32_t i) {
+        return components.renders[i].lod * 2 + (TransformSystem::isUniformScale(components.transforms[i]) ? 0 : 1);
+    }
+
+    // Counting sort of the visible instances into contiguous bucket ranges
+    void buildStaging(const ComponentArrays& components, const RenderView& renderView) {
+        size_t counts[BUCKET_COUNT] = {};
+        std::fill(mBucketDepth, mBucketDepth + BUCKET_COUNT, renderView.farPlane());
+        for (size_t v = 0; v < mVisibleCount; ++v) {
+            uint32_t i = mVisible[v];
+            int bucket = bucketOf(components, i);
+            counts[bucket]++;
+            float depth = renderView.viewDepth(glm::vec3(mCullX[i], mCullY[i], mCullZ[i])) - mCullRadius[i];
+            mBucketDepth[bucket] = std::min(mBucketDepth[bucket], depth);
+        }
+
+        mBucketOffsets[0] = 0;
+        for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+            mBucketOffsets[bucket + 1] = mBucketOffsets[bucket] + counts[bucket];
+        }
+
+        size_t cursor[BUCKET_COUNT];
+        std::copy(mBucketOffsets, mBucketOffsets + BUCKET_COUNT, cursor);
+        mStaging.resize(mVisibleCount);
+        for (size_t v = 0; v < mVisibleCount; ++v) {
+            uint32_t i = mVisible[v];
+            mStaging[cursor[bucketOf(components, i)]++] = components.instances[i];
+        }
+    }
+
+    void upload() {
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+        if (mStaging.size() > mInstanceCapacity) {
+            mInstanceCapacity = mStaging.size() * 2;
+            glBufferData(GL_ARRAY_BUFFER, mInstanceCapacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mStaging.size() * sizeof(InstanceData), mStaging.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
 };
 
 
 
 
+
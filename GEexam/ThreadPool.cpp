@@ -0,0 +1,91 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t workerCount) {
+    if (workerCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    mWorkers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    for (std::thread& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& job) {
+    if (count == 0) return;
+
+    // Not worth waking anyone for a single job
+    if (count == 1 || mWorkers.empty()) {
+        for (size_t i = 0; i < count; ++i) job(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> dispatch(mDispatch);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJob = &job;
+        mJobCount = count;
+        mNextIndex = 0;
+        mDoneCount = 0;
+        mGeneration++;
+    }
+    mWake.notify_all();
+
+    runJobs();
+
+    // Wait for the jobs still running on workers, and for every worker to let go of mJob
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFinished.wait(lock, [this] { return mDoneCount == mJobCount && mActiveWorkers == 0; });
+    mJob = nullptr;
+}
+
+void ThreadPool::runJobs() {
+    size_t index;
+    while ((index = mNextIndex.fetch_add(1)) < mJobCount) {
+        (*mJob)(index);
+        if (mDoneCount.fetch_add(1) + 1 == mJobCount) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFinished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [&] { return mStopping || mGeneration != seenGeneration; });
+            if (mStopping) return;
+            seenGeneration = mGeneration;
+
+            // Woke up after the caller already finished that loop
+            if (mJob == nullptr) continue;
+            mActiveWorkers++;
+        }
+
+        runJobs();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (--mActiveWorkers == 0) {
+            mFinished.notify_all();
+        }
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
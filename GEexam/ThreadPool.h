@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+// Fixed set of worker threads for data-parallel loops. The calling thread helps,
+// so a pool with no workers just runs the loop inline.
+class ThreadPool {
+public:
+    // 0 = one worker per hardware thread, minus the caller
+    explicit ThreadPool(size_t workerCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs job(index) for every index in [0, count) and returns when all are done.
+    // Indices are handed out one at a time, so jobs should be coarse (a block of work each).
+    void parallelFor(size_t count, const std::function<void(size_t)>& job);
+
+    size_t getWorkerCount() const { return mWorkers.size(); }
+
+    static ThreadPool& shared();
+
+private:
+    void workerLoop();
+    void runJobs();
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mFinished;
+    std::mutex mDispatch;                   // One parallelFor at a time
+
+    const std::function<void(size_t)>* mJob = nullptr;
+    size_t mJobCount = 0;
+    std::atomic<size_t> mNextIndex{ 0 };
+    std::atomic<size_t> mDoneCount{ 0 };
+    uint64_t mGeneration = 0;
+    size_t mActiveWorkers = 0;
+    bool mStopping = false;
+};
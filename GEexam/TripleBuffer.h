@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Lock-free handoff of whole frames from one producer thread to one consumer thread.
+// The producer fills write() and publishes it; the consumer takes the newest published
+// frame with acquire() and reads it until its next acquire. Neither side ever waits,
+// frames published in between are skipped.
+template <typename T>
+class TripleBuffer {
+public:
+    // Producer side. The slot keeps whatever it held three publishes ago, so vectors in
+    // it reuse their storage.
+    T& write() { return mSlots[mWrite]; }
+
+    // Hands write() over as the newest frame and moves on to the slot that comes back
+    void publish() {
+        uint8_t previous = mShared.exchange(static_cast<uint8_t>(mWrite | FRESH), std::memory_order_acq_rel);
+        mWrite = previous & INDEX;
+    }
+
+    // Consumer side. Swaps in the newest frame if one was published since the last call.
+    bool acquire() {
+        if (!(mShared.load(std::memory_order_relaxed) & FRESH)) return false;
+        uint8_t previous = mShared.exchange(mRead, std::memory_order_acq_rel);
+        mRead = previous & INDEX;
+        return true;
+    }
+
+    const T& read() const { return mSlots[mRead]; }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    T mSlots[3];
+    uint8_t mWrite = 0;                     // Producer only
+    uint8_t mRead = 1;                      // Consumer only
+    std::atomic<uint8_t> mShared{ 2 };      // Slot between them, FRESH until acquired
+};
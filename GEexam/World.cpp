@@ -1,4 +1,6 @@
 #include "World.h"
+#include <algorithm>
+#include <chrono>
 
 //World::World() : mBox(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(50.0f, 10.0f, 50.0f)) // Box at position (0, 0, 0) with size (, , )
 //{
@@ -20,16 +22,230 @@
 //}
 
 
-World::World() {
+World::World(uint64_t seed) : mSeed(seed) {
     mWorldBounds.min = glm::vec3(-25.0f, -25.0f, -25.0f);
     mWorldBounds.max = glm::vec3(25.0f, 25.0f, 25.0f);
 }
 
+World::~World() {
+    setThreaded(false);
+}
+
+void World::post(SimulationThread::Command command) {
+    if (mSimulation.isRunning()) mSimulation.post(std::move(command));
+    else command();
+}
+
+void World::call(const SimulationThread::Command& command) const {
+    if (mSimulation.isRunning()) mSimulation.call(command);
+    else command();
+}
+
+void World::setThreaded(bool threaded) {
+    if (threaded == isThreaded()) return;
+
+    if (threaded) {
+        for (auto& box : mBox) {
+            box.setDeferredUpload(true);
+        }
+        // Something to draw until the thread's first batch is done
+        mFrameChanged = true;
+        publishFrame();
+        mRenderFrames.acquire();
+        mSimulation.start([this] { publishFrame(); });
+    }
+    else {
+        mSimulation.stop();
+        for (auto& box : mBox) {
+            box.setDeferredUpload(mHeadless);
+        }
+    }
+}
+
+void World::setHeadless(bool headless) {
+    call([this, headless] {
+        mHeadless = headless;
+        for (auto& box : mBox) {
+            box.setDeferredUpload(headless || isThreaded());
+        }
+    });
+}
+
+void World::flush() {
+    call([] {});
+}
+
+void World::publishFrame() {
+    if (!mFrameChanged) return;
+    mFrameChanged = false;
+
+    RenderFrame& frame = mRenderFrames.write();
+    frame.boxes.resize(mBox.size());
+    for (size_t i = 0; i < mBox.size(); ++i) {
+        mBox[i].publish(frame.boxes[i]);
+    }
+    frame.particleBudget = mParticleBudget.getStats();
+    mRenderFrames.publish();
+}
+
 void World::addBox(const glm::vec3& position, const glm::vec3& size) {
-    mBox.emplace_back(position, size); // Add a new Box to the world
+    bool threaded = isThreaded();
+    setThreaded(false);
+
+    // Each box gets its own stream of the world seed, fixed by insertion order
+    mBox.emplace_back(position, size, mSeed, static_cast<uint64_t>(mBox.size()));
+    mBox.back().setPhysicsSettings(mPhysicsSettings);
+    mBox.back().setDeferredUpload(mHeadless);
+
+    setThreaded(threaded);
+}
+
+void World::setPhysicsSettings(const PhysicsSettings& settings) {
+    mPhysicsSettings = settings;
+    post([this, settings] {
+        for (auto& box : mBox) {
+            box.setPhysicsSettings(settings);
+        }
+    });
+}
+
+void World::setDeterministic(bool deterministic) {
+    mDeterministic = deterministic;
+    post([this, deterministic] { mParticleBudget.setDeterministic(deterministic); });
+}
+
+void World::setParticleBudget(const ParticleBudgetSettings& settings) {
+    post([this, settings] { mParticleBudget.setSettings(settings); });
+}
+
+const ParticleBudgetStats& World::getParticleBudgetStats() const {
+    return isThreaded() ? mRenderFrames.read().particleBudget : mParticleBudget.getStats();
+}
+
+void World::setParticlePriority(size_t box, float priority) {
+    post([this, box, priority] {
+        if (box < mBox.size()) {
+            mBox[box].getParticleSystem().setPriority(priority);
+        }
+    });
+}
+
+void World::setStateHashInterval(int interval) {
+    post([this, interval] { mStateHashInterval = interval; });
+}
+
+uint64_t World::computeStateHash() const {
+    uint64_t hash = 0;
+    call([&] { hash = hashState(); });
+    return hash;
+}
+
+uint64_t World::hashState() const {
+    StateHash hash;
+    hash.add(static_cast<uint64_t>(mBox.size()));
+    for (const auto& box : mBox) {
+        box.hashState(hash);
+    }
+    mParticleBudget.hashState(hash);
+    return hash.get();
+}
+
+void World::setSnapshotCapacity(size_t count) {
+    call([&] {
+        mSnapshots.resize(count);
+        mNextSnapshot = 0;
+        // Saving once grows every slot's storage, later saves of a similar state reuse it
+        for (auto& snapshot : mSnapshots) {
+            snapshot.boxes.resize(mBox.size());
+            for (size_t i = 0; i < mBox.size(); ++i) {
+                mBox[i].saveState(snapshot.boxes[i]);
+            }
+            snapshot.valid = false;
+        }
+    });
+}
+
+bool World::saveSnapshot() {
+    bool saved = false;
+    call([&] {
+        if (mSnapshots.empty()) return;
+
+        Snapshot& snapshot = mSnapshots[mNextSnapshot];
+        mNextSnapshot = (mNextSnapshot + 1) % mSnapshots.size();
+
+        snapshot.boxes.resize(mBox.size());
+        for (size_t i = 0; i < mBox.size(); ++i) {
+            mBox[i].saveState(snapshot.boxes[i]);
+        }
+        mParticleBudget.saveState(snapshot.particleBudget);
+        snapshot.frame = mFrame;
+        snapshot.valid = true;
+        saved = true;
+    });
+    return saved;
+}
+
+bool World::restoreSnapshot(uint64_t frame) {
+    bool restored = false;
+    call([&] {
+        for (size_t slot = 0; slot < mSnapshots.size(); ++slot) {
+            const Snapshot& snapshot = mSnapshots[slot];
+            if (!snapshot.valid || snapshot.frame != frame || snapshot.boxes.size() != mBox.size()) continue;
+
+            for (size_t i = 0; i < mBox.size(); ++i) {
+                mBox[i].restoreState(snapshot.boxes[i]);
+            }
+            mParticleBudget.restoreState(snapshot.particleBudget);
+            mFrame = frame;
+            // Later snapshots belong to the discarded timeline. They were saved into the
+            // slots after this one, so the next saves reuse those before the oldest valid one.
+            for (auto& later : mSnapshots) {
+                if (later.frame > frame) later.valid = false;
+            }
+            mNextSnapshot = (slot + 1) % mSnapshots.size();
+            while (!mStateHashes.empty() && mStateHashes.back().frame > frame) {
+                mStateHashes.pop_back();
+            }
+            mFrameChanged = true;
+            restored = true;
+            return;
+        }
+    });
+    return restored;
+}
+
+void World::applyForce(uint32_t entity, const glm::vec3& force) {
+    // Spheres live in the first box, see createSphereEntity
+    post([this, entity, force] {
+        if (!mBox.empty()) {
+            mBox[0].applyForce(entity, force);
+        }
+    });
+}
+
+bool World::addJoint(uint32_t a, uint32_t b, float stiffness, float damping, float restLength) {
+    bool added = false;
+    call([&] { added = !mBox.empty() && mBox[0].addJoint(a, b, stiffness, damping, restLength); });
+    return added;
+}
+
+void World::setParticleEffect(const ParticleEffect& effect) {
+    post([this, effect] {
+        for (auto& box : mBox) {
+            box.setParticleEffect(effect);
+        }
+    });
 }
 
 uint32_t World::createSphereEntity(const glm::vec3& position, const glm::vec3& velocity, float radius, glm::vec3 color) {
+    uint32_t entity = 0;
+    call([&] { entity = createSphere(position, velocity, radius, color); });
+    return entity;
+}
+
+uint32_t World::createSphere(const glm::vec3& position, const glm::vec3& velocity, float radius, glm::vec3 color) {
+    mFrameChanged = true;
+
     // Choose a box to add the sphere to (basic example: first box)
     if (!mBox.empty()) {
         return mBox[0].addSphereEntity(position, velocity, radius, color);
@@ -52,15 +268,113 @@ uint32_t World::createSphereEntity(const glm::vec3& position, const glm::vec3& v
 }
 
 void World::update(float deltaTime) {
-    for (auto& box : mBox) {
-        box.update(deltaTime);
+    if (!isThreaded()) {
+        simulate(deltaTime, mRenderView.cameraPosition());
+        return;
+    }
+
+    // Rendering runs at most MAX_QUEUED_STEPS ahead; a slower simulation holds it back
+    // here, and FrameClock's catch-up cap then drops time as it does without the thread
+    {
+        std::unique_lock<std::mutex> lock(mStepMutex);
+        mStepDone.wait(lock, [this] { return mQueuedSteps < MAX_QUEUED_STEPS; });
+        ++mQueuedSteps;
     }
+    glm::vec3 cameraPosition = mRenderView.cameraPosition();
+    mSimulation.post([this, deltaTime, cameraPosition] {
+        simulate(deltaTime, cameraPosition);
+        std::lock_guard<std::mutex> lock(mStepMutex);
+        --mQueuedSteps;
+        mStepDone.notify_one();
+    });
 }
 
-void World::render(Shader& shader, const glm::mat4& view, const glm::mat4& projection) {
+void World::simulate(float deltaTime, const glm::vec3& cameraPosition) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Split the particle budget by priority and distance to the last rendered camera.
+    // Emission rates scale with each emitter's share of its capacity.
+    mParticleRequests.resize(mBox.size());
+    for (size_t i = 0; i < mBox.size(); ++i) {
+        const ParticleSystem& particles = mBox[i].getParticleSystem();
+        mParticleRequests[i] = { particles.getPriority(), particles.getCenter(), static_cast<size_t>(particles.getCapacity()) };
+    }
+    mParticleBudget.allocate(mParticleRequests, cameraPosition, mParticleLimits);
+    for (size_t i = 0; i < mBox.size(); ++i) {
+        float rateScale = static_cast<float>(mParticleLimits[i]) / std::max(mParticleRequests[i].capacity, size_t(1));
+        mBox[i].getParticleSystem().setBudget(mParticleLimits[i], rateScale);
+    }
+
     for (auto& box : mBox) {
-        box.render(shader, view, projection);
+        box.update(deltaTime);
+    }
+
+    // Measured cost drives next frame's budget
+    float particleMs = 0.0f;
+    size_t alive = 0;
+    for (const auto& box : mBox) {
+        particleMs += box.getParticleSystem().getLastUpdateMs();
+        alive += box.getParticleSystem().getAliveCount();
     }
+    mParticleBudget.reportFrame(particleMs, alive);
+
+    mLastTimings = WorldUpdateTimings();
+    for (const auto& box : mBox) {
+        const SphereUpdateTimings& spheres = box.getSpheres().getLastTimings();
+        const ParticleUpdateTimings& particles = box.getParticleSystem().getLastTimings();
+        mLastTimings.spheres.jointMs += spheres.jointMs;
+        mLastTimings.spheres.integrateMs += spheres.integrateMs;
+        mLastTimings.spheres.gridMs += spheres.gridMs;
+        mLastTimings.spheres.contactMs += spheres.contactMs;
+        mLastTimings.spheres.eventMs += spheres.eventMs;
+        mLastTimings.particles.updateMs += particles.updateMs;
+        mLastTimings.particles.spawnMs += particles.spawnMs;
+        mLastTimings.particles.uploadMs += particles.uploadMs;
+        mLastTimings.particles.updated += particles.updated;
+        mLastTimings.particles.spawned += particles.spawned;
+        mLastTimings.particles.uploaded += particles.uploaded;
+        mLastTimings.sphereCount += box.getSpheres().getSphereCount();
+    }
+    mLastTimings.particleMs = particleMs;
+    mLastTimings.particleCount = alive;
+
+    ++mFrame;
+    if (mStateHashInterval > 0 && mFrame % mStateHashInterval == 0) {
+        // Bounded for long runs: the oldest half goes when it fills up
+        if (mStateHashes.size() >= MAX_STATE_HASHES) {
+            mStateHashes.erase(mStateHashes.begin(), mStateHashes.begin() + MAX_STATE_HASHES / 2);
+        }
+        mStateHashes.push_back({ mFrame, hashState() });
+    }
+    mFrameChanged = true;
+    mLastTimings.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
+void World::setViewport(int width, int height) {
+    mRenderView.viewportWidth = static_cast<float>(width);
+    mRenderView.viewportHeight = static_cast<float>(height);
+}
 
+void World::render(Shader& shader, const glm::mat4& view, const glm::mat4& projection, float interpolation) {
+    mRenderView.view = view;
+    mRenderView.projection = projection;
+    mRenderView.interpolation = interpolation;
+    mRenderView.frustum.extract(projection * view);
+
+    // Boxes only submit; all GL calls happen in the sorted flush
+    mRenderQueue.clear();
+    if (isThreaded()) {
+        // Newest finished frame, or the last one again if the thread hasn't published since
+        mRenderFrames.acquire();
+        const RenderFrame& frame = mRenderFrames.read();
+        for (size_t i = 0; i < mBox.size() && i < frame.boxes.size(); ++i) {
+            mBox[i].render(shader, mRenderQueue, mRenderView, frame.boxes[i]);
+        }
+    }
+    else {
+        for (auto& box : mBox) {
+            box.render(shader, mRenderQueue, mRenderView);
+        }
+    }
+    mRenderQueue.flush(mRenderView);
+}
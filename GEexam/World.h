@@ -3,25 +3,177 @@
 #include "Shader.h"
 #include "EntityManager.h"
 #include "SystemManager.h"
+#include "RenderView.h"
+#include "RenderQueue.h"
+#include "ParticleBudget.h"
+#include "StateHash.h"
+#include "Random.h"
+#include "SimulationThread.h"
+#include "TripleBuffer.h"
+#include <mutex>
+#include <condition_variable>
 #include <glm/glm.hpp>
 
+// Wall time of the last update() and its CPU time per system, summed over the boxes
+struct WorldUpdateTimings {
+    double totalMs = 0.0;
+    double particleMs = 0.0;
+    SphereUpdateTimings spheres;
+    ParticleUpdateTimings particles;
+    size_t sphereCount = 0;
+    size_t particleCount = 0;
+};
 
 class World {
 public:
-    World();
+    // seed drives every box's particle RNG; two worlds with the same seed and inputs
+    // produce the same states
+    explicit World(uint64_t seed = Random::DEFAULT_SEED);
+    ~World();
+
+    // Steps update() may queue ahead of the simulation thread before it waits for one
+    static constexpr int MAX_QUEUED_STEPS = 2;
+
+    static constexpr size_t MAX_STATE_HASHES = 4096;
 
     // Add a new sphere entity to the world
     uint32_t createSphereEntity(const glm::vec3& position, const glm::vec3& velocity, float radius, glm::vec3 color);
 
+    // Grows the box list, so a threaded world stops its thread for it. GL objects are
+    // created on the box's first render.
     void addBox(const glm::vec3& position, const glm::vec3& size);
     void update(float deltaTime);
-    void render(Shader& shader, const glm::mat4& view, const glm::mat4& projection);
+    // interpolation: how far the frame is past the last update(), as a fraction of its step.
+    // Spheres are drawn that far between their previous and current positions.
+    void render(Shader& shader, const glm::mat4& view, const glm::mat4& projection, float interpolation = 1.0f);
+
+    // Integrator, gravity and drag for every box, including ones added later
+    void setPhysicsSettings(const PhysicsSettings& settings);
+    const PhysicsSettings& getPhysicsSettings() const { return mPhysicsSettings; }
+
+    // Adds a force to a sphere for the next update only, same entity ids as createSphereEntity
+    void applyForce(uint32_t entity, const glm::vec3& force);
+
+    // Joins two spheres with a damped spring, same entity ids as createSphereEntity.
+    // restLength < 0 keeps their current distance.
+    bool addJoint(uint32_t a, uint32_t b, float stiffness, float damping, float restLength = -1.0f);
+
+    // Applies an emitter and affector stack to the particles of every box
+    void setParticleEffect(const ParticleEffect& effect);
+
+    // Framebuffer size, used for screen-space LOD selection
+    void setViewport(int width, int height);
+
+    // Global particle cap shared by the boxes' emitters, see ParticleBudget. Threaded
+    // worlds report the stats of the frame last rendered.
+    void setParticleBudget(const ParticleBudgetSettings& settings);
+    const ParticleBudgetStats& getParticleBudgetStats() const;
+
+    // Budget share of one box's emitter relative to the others at the same distance,
+    // boxes in addBox order. Ignored for boxes that don't exist yet.
+    void setParticlePriority(size_t box, float priority);
+
+    // Removes the camera and timing feedback from the particle budget, so update() depends
+    // only on the seed, the inputs and the step size
+    void setDeterministic(bool deterministic);
+    bool isDeterministic() const { return mDeterministic; }
+
+    // Hash of every sphere and particle, for comparing runs or replays
+    uint64_t computeStateHash() const;
+
+    // Records computeStateHash() every interval updates, 0 turns it off. Keeps the newest
+    // MAX_STATE_HASHES / 2 to MAX_STATE_HASHES records.
+    void setStateHashInterval(int interval);
+    const std::vector<StateHashRecord>& getStateHashes() const { return mStateHashes; }
+    uint64_t getFrame() const { return mFrame; }
+
+    // Preallocates a ring of count snapshots sized for the current state. Saving past
+    // the end overwrites the oldest.
+    void setSnapshotCapacity(size_t count);
+
+    // Captures every box into the next ring slot, tagged with getFrame(). False without
+    // capacity.
+    bool saveSnapshot();
+
+    // Rolls back to the snapshot taken at frame and drops the state hashes recorded after
+    // it, ready to re-simulate. False if the ring no longer holds that frame or boxes were
+    // added since.
+    bool restoreSnapshot(uint64_t frame);
+
+    // No rendering at all: particle vertices stay on the CPU, so update() makes no GL
+    // calls and the world runs without a context. render() must not be called.
+    void setHeadless(bool headless);
+
+    // Read by the simulation thread's state like getFrame(), so flush() first
+    const WorldUpdateTimings& getLastUpdateTimings() const { return mLastTimings; }
+
+    // Frustum culling counters from the last render
+    const CullStats& getCullStats() const { return mRenderView.frustum.getStats(); }
+
+    // Moves update() onto a thread of its own so physics overlaps rendering. update()
+    // then only queues the step, and render() draws the newest frame the thread has
+    // finished, handed over through a triple buffer. Calls that change the simulation
+    // are queued behind the steps in order; calls that return something wait for it.
+    // getFrame() and getStateHashes() read the thread's state, call flush() first.
+    void setThreaded(bool threaded);
+    bool isThreaded() const { return mSimulation.isRunning(); }
+
+    // Waits until the simulation thread has run everything queued so far
+    void flush();
 
 private:
+    // update() and computeStateHash() on whichever thread owns the simulation
+    void simulate(float deltaTime, const glm::vec3& cameraPosition);
+    uint64_t hashState() const;
+    uint32_t createSphere(const glm::vec3& position, const glm::vec3& velocity, float radius, glm::vec3 color);
+
+    // Runs command on the simulation thread when there is one, otherwise right here
+    void post(SimulationThread::Command command);
+    void call(const SimulationThread::Command& command) const;
+
+    // Simulation thread side of setThreaded: hands the boxes' draw state to render()
+    void publishFrame();
+
     std::vector<Box> mBox;              
     EntityManager mEntityManager;        
     ComponentArrays mComponents;       
     WorldBoundsComponent mWorldBounds;  
+    PhysicsSettings mPhysicsSettings;
+    RenderView mRenderView;
+    RenderQueue mRenderQueue;
+
+    ParticleBudget mParticleBudget;
+    std::vector<ParticleBudgetRequest> mParticleRequests;
+    std::vector<size_t> mParticleLimits;
+
+    uint64_t mSeed;
+    bool mDeterministic = false;
+    bool mHeadless = false;
+    WorldUpdateTimings mLastTimings;
+    uint64_t mFrame = 0;
+    int mStateHashInterval = 0;
+    std::vector<StateHashRecord> mStateHashes;
+
+    struct Snapshot {
+        bool valid = false;
+        uint64_t frame = 0;
+        std::vector<Box::Snapshot> boxes;
+        ParticleBudget::State particleBudget;
+    };
+    std::vector<Snapshot> mSnapshots;
+    size_t mNextSnapshot = 0;
+
+    struct RenderFrame {
+        std::vector<Box::RenderFrame> boxes;
+        ParticleBudgetStats particleBudget;
+    };
+    TripleBuffer<RenderFrame> mRenderFrames;
+    bool mFrameChanged = false;         // Simulation side, something to publish
+
+    mutable SimulationThread mSimulation;
+    std::mutex mStepMutex;
+    std::condition_variable mStepDone;
+    int mQueuedSteps = 0;
 };
 
 
@@ -37,3 +37,9 @@ end
 
 
 
+
+-- Particle effect, rebuilt on every reload
+setEmitter(200.0, 10.0)
+addGravity(0.0, -2.0, 0.0)
+addDrag(0.5)
+setColorOverLife(0.6, 0.8, 1.0, 0.1, 0.2, 0.8) -- Light blue fading to dark blue
@@ -0,0 +1,39 @@
+// Same scene, same seed: the state hash must not depend on the run or on the thread the
+// simulation steps on.
+//
+//   DeterminismTest <scene.txt>
+#include "TestCheck.h"
+#include "SceneLoader.h"
+
+const int FRAMES = 120;
+const float STEP = 1.0f / 60.0f;
+
+static uint64_t runScene(const char* path, bool threaded) {
+    std::unique_ptr<World> world = loadScene(path);
+    CHECK(world != nullptr);
+    if (!world) return 0;
+
+    world->setThreaded(threaded);
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        world->update(STEP);
+    }
+    world->flush();
+    CHECK(world->getFrame() == FRAMES);
+    return world->computeStateHash();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: DeterminismTest <scene.txt>\n");
+        return 1;
+    }
+
+    uint64_t first = runScene(argv[1], false);
+    uint64_t second = runScene(argv[1], false);
+    uint64_t threaded = runScene(argv[1], true);
+    std::printf("serial %016llx %016llx threaded %016llx\n", static_cast<unsigned long long>(first),
+        static_cast<unsigned long long>(second), static_cast<unsigned long long>(threaded));
+    CHECK(first == second);
+    CHECK(first == threaded);
+    return testResult();
+}
@@ -0,0 +1,27 @@
+// Renders a box of spheres through HeadlessDriver on the recording GL backend, so the render
+// path runs without a context. Runs from the source directory so the shaders load.
+#include "TestCheck.h"
+#include "HeadlessDriver.h"
+
+int main() {
+    HeadlessDriver driver(GLRecorder::Mode::Null);
+    World& world = driver.getWorld();
+    world.addBox(glm::vec3(0.0f), glm::vec3(20.0f, 10.0f, 20.0f));
+    for (int i = 0; i < 64; ++i) {
+        float x = static_cast<float>(i % 8) * 2.0f - 7.0f;
+        float z = static_cast<float>(i / 8) * 2.0f - 7.0f;
+        world.createSphereEntity(glm::vec3(x, 3.0f, z), glm::vec3(1.0f, 0.0f, -1.0f), 0.5f, glm::vec3(1.0f, 0.0f, 0.0f));
+    }
+
+    const size_t frames = 60;
+    HeadlessReport report = driver.run(frames, 1.0f / 60.0f);
+    CHECK(report.frames == frames);
+    CHECK(report.totals.drawCalls >= frames);
+    CHECK(report.totals.bufferUploads > 0);
+    CHECK(report.worstRenderMs >= 0.0);
+
+    HeadlessFrame frame = driver.step(1.0f / 60.0f);
+    CHECK(frame.gl.drawCalls > 0);
+    CHECK(frame.gl.bufferUploads > 0);
+    return testResult();
+}
@@ -0,0 +1,23 @@
+// A sphere whose colour changes gets its instance rebuilt even when it hasn't moved.
+#include "TestCheck.h"
+#include "SystemManager.h"
+
+int main() {
+    ComponentArrays components;
+    components.resize(2);
+    for (size_t i = 0; i < 2; ++i) {
+        components.transforms[i].position = glm::vec3(static_cast<float>(i), 0.0f, 0.0f);
+        components.previousPositions[i] = components.transforms[i].position;
+        components.transformDirty[i] = 1;
+    }
+    CHECK(TransformSystem::updateInstances(components) == 2);
+
+    // Nothing moved or changed
+    CHECK(TransformSystem::updateInstances(components) == 0);
+
+    components.renders[1].color = glm::vec3(0.0f, 0.0f, 1.0f);
+    CHECK(TransformSystem::updateInstances(components) == 1);
+    CHECK(components.instances[1].color == glm::vec3(0.0f, 0.0f, 1.0f));
+    CHECK(TransformSystem::updateInstances(components) == 0);
+    return testResult();
+}
@@ -0,0 +1,45 @@
+// Wind blows particles out of the box. The float format keeps drawing them where they are,
+// the quantized formats can't hold them and kill them instead of drawing them on the wall.
+#include "TestCheck.h"
+#include "ParticleSystem.h"
+
+static ParticleSystem::RenderFrame run(ParticleFormat format) {
+    ParticleSystem particles(1000, glm::vec3(-5.0f, 0.0f, -5.0f), glm::vec3(5.0f, 5.0f, 5.0f), 7, 0);
+    ParticleEffect effect;
+    effect.emitter.lifetime = 20.0f;
+    effect.emitter.velocityMin = glm::vec3(0.0f, -0.5f, 0.0f);
+    effect.emitter.velocityMax = glm::vec3(0.0f, -0.1f, 0.0f);
+    effect.affectors.push_back(Affector::wind(glm::vec3(8.0f, 0.0f, 0.0f), 4.0f));
+    particles.setEffect(effect);
+    particles.setFormat(format);
+    particles.setDeferredUpload(true);
+    for (int frame = 0; frame < 120; ++frame) {
+        particles.update(1.0f / 60.0f);
+    }
+
+    ParticleSystem::RenderFrame frame;
+    particles.publish(frame);
+    return frame;
+}
+
+int main() {
+    ParticleSystem::RenderFrame floats = run(ParticleFormat::Float);
+    size_t outside = 0;
+    for (int i = 0; i < floats.drawCount; ++i) {
+        const float* position = reinterpret_cast<const float*>(floats.vertices.data()) + i * 3;
+        outside += position[0] > floats.boxMax.x;
+    }
+    CHECK(outside > 0);
+
+    ParticleSystem::RenderFrame quantized = run(ParticleFormat::Unorm16);
+    CHECK(quantized.drawCount > 0);
+
+    // Clamped particles would all sit on the far wall
+    size_t onWall = 0;
+    for (int i = 0; i < quantized.drawCount; ++i) {
+        const uint16_t* position = reinterpret_cast<const uint16_t*>(quantized.vertices.data()) + i * 3;
+        onWall += position[0] == 65535;
+    }
+    CHECK(onWall == 0);
+    return testResult();
+}
@@ -0,0 +1,35 @@
+// Colour over life measures each particle's age against the lifetime it spawned with, so a
+// new effect with another lifetime doesn't recolour the particles already alive.
+#include "TestCheck.h"
+#include "ParticleSystem.h"
+
+static ParticleEffect fadingEffect(float lifetime) {
+    ParticleEffect effect;
+    effect.emitter.lifetime = lifetime;
+    effect.affectors.push_back(Affector::colorOverLife(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+    return effect;
+}
+
+int main() {
+    ParticleSystem particles(1000, glm::vec3(-5.0f, 0.0f, -5.0f), glm::vec3(5.0f, 5.0f, 5.0f), 7, 0);
+    particles.setEffect(fadingEffect(4.0f));
+    particles.setDeferredUpload(true);
+    for (int frame = 0; frame < 30; ++frame) {
+        particles.update(1.0f / 60.0f);
+    }
+
+    ParticleSystem::RenderFrame before;
+    particles.update(0.0f);
+    particles.publish(before);
+    CHECK(before.colorOverLife);
+    CHECK(before.drawCount > 0);
+
+    // Same particles and lifetimes left, only the emitter's lifetime changed
+    particles.setEffect(fadingEffect(40.0f));
+    ParticleSystem::RenderFrame after;
+    particles.update(0.0f);
+    particles.publish(after);
+    CHECK(after.drawCount == before.drawCount);
+    CHECK(after.vertices == before.vertices);
+    return testResult();
+}
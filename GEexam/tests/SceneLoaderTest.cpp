@@ -0,0 +1,35 @@
+// loadScene rejects lines with missing or unreadable arguments and joints addJoint()
+// refuses, instead of loading them with zeros.
+#include "TestCheck.h"
+#include "SceneLoader.h"
+#include <cstdio>
+#include <fstream>
+
+static bool loads(const char* text) {
+    const char* path = "SceneLoaderTest.txt";
+    {
+        std::ofstream file(path);
+        file << "box 0 0 0 20 20 20\n" << text << "\n";
+    }
+    bool loaded = loadScene(path) != nullptr;
+    std::remove(path);
+    return loaded;
+}
+
+int main() {
+    CHECK(loads("sphere 0 0 0 1 0 0 0.5"));
+    CHECK(loads("spheres 4 0.5 2\njoint 0 1 100 1"));
+    CHECK(loads("spheres 4 0.5 2\njoint 0 1 100 1 2.5"));
+    CHECK(loads("mode event"));
+
+    CHECK(!loads("spheres abc 0.5 4"));
+    CHECK(!loads("spheres -3 0.5 4"));
+    CHECK(!loads("box 0 0 0"));
+    CHECK(!loads("sphere 0 0 0 1 0 0"));
+    CHECK(!loads("spheres 4 0.5 2\njoint 0 1 100"));
+    CHECK(!loads("spheres 4 0.5 2\njoint 0 1 100 1 abc"));
+    CHECK(!loads("spheres 4 0.5 2\njoint 0 9 100 1"));
+    CHECK(!loads("gravity 0 -9.8"));
+    CHECK(!loads("mode slow"));
+    return testResult();
+}
@@ -0,0 +1,76 @@
+// Spring joints are solved implicitly by JointSolver under both integrators: an undamped
+// spring never gains energy, and a stiff chain settles at its rest length with 16 ms steps,
+// far past the 2 / sqrt(k / m) limit of an explicit spring.
+#include "TestCheck.h"
+#include "CollideSpheres.h"
+#include <cmath>
+#include <cstdio>
+
+const float STEP = 1.0f / 60.0f;
+
+static double energy(const ComponentArrays& components) {
+    const SpringJoint& joint = components.joints[0];
+    double kinetic = 0.0;
+    for (size_t i = 0; i < 2; ++i) {
+        const glm::vec3& velocity = components.physics[i].velocity;
+        kinetic += 0.5 * components.physics[i].mass * glm::dot(velocity, velocity);
+    }
+    double stretch = glm::length(components.transforms[0].position - components.transforms[1].position) - joint.restLength;
+    return kinetic + 0.5 * joint.stiffness * stretch * stretch;
+}
+
+static void checkUndampedSpring(Integrator integrator) {
+    CollideSpheres spheres(glm::vec3(0.0f), glm::vec3(100.0f));
+    spheres.addSphere(glm::vec3(-3.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 0.5f, glm::vec3(1.0f));
+    spheres.addSphere(glm::vec3(3.0f, 0.5f, 0.0f), glm::vec3(0.0f), 0.5f, glm::vec3(1.0f));
+    CHECK(spheres.addJoint(0, 1, 50.0f, 0.0f, 4.0f));
+    PhysicsSettings settings;
+    settings.integrator = integrator;
+    spheres.setPhysicsSettings(settings);
+
+    const double start = energy(spheres.getComponents());
+    double highest = start;
+    for (int step = 0; step < 1000; ++step) {
+        spheres.update(STEP);
+        highest = std::max(highest, energy(spheres.getComponents()));
+    }
+    std::printf("undamped: energy %.4f, highest %.4f\n", start, highest);
+    CHECK(highest <= start * 1.001);
+}
+
+// A stretched chain of stiff springs, k / m = 1e6, one second of 16 ms steps
+static void checkStiffChain(Integrator integrator) {
+    const int LINKS = 5;
+    CollideSpheres spheres(glm::vec3(0.0f), glm::vec3(100.0f));
+    for (int i = 0; i <= LINKS; ++i) {
+        spheres.addSphere(glm::vec3(static_cast<float>(i) * 1.5f, 0.0f, 0.0f), glm::vec3(0.0f), 0.2f, glm::vec3(1.0f));
+    }
+    for (int i = 0; i < LINKS; ++i) {
+        CHECK(spheres.addJoint(i, i + 1, 1e6f, 10.0f, 1.0f));
+    }
+    PhysicsSettings settings;
+    settings.integrator = integrator;
+    spheres.setPhysicsSettings(settings);
+
+    for (int step = 0; step < 60; ++step) {
+        spheres.update(STEP);
+        CHECK(!spheres.getJointStats().failed);
+    }
+
+    const ComponentArrays& components = spheres.getComponents();
+    double worst = 0.0;
+    for (int i = 0; i < LINKS; ++i) {
+        double length = glm::length(components.transforms[i + 1].position - components.transforms[i].position);
+        worst = std::isfinite(length) ? std::max(worst, std::abs(length - 1.0)) : INFINITY;
+    }
+    std::printf("stiff chain: largest stretch %.6f after %d sub-steps per update\n", worst, spheres.getLastSubSteps());
+    CHECK(worst < 1e-3);
+}
+
+int main() {
+    checkUndampedSpring(Integrator::SemiImplicitEuler);
+    checkUndampedSpring(Integrator::VelocityVerlet);
+    checkStiffChain(Integrator::SemiImplicitEuler);
+    checkStiffChain(Integrator::VelocityVerlet);
+    return testResult();
+}
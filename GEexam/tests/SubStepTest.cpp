@@ -0,0 +1,32 @@
+// chooseSubSteps stays within [1, ceiling] for any velocity, including ones whose travel
+// ratio doesn't fit an int.
+#include "TestCheck.h"
+#include "SystemManager.h"
+#include <limits>
+
+static int subSteps(float speed, const PhysicsSettings& settings, float deltaTime = 1.0f / 60.0f) {
+    ComponentArrays components;
+    components.resize(4);
+    components.physics[2].velocity = glm::vec3(speed, 0.0f, 0.0f);
+    PhysicsSystem::Scratch scratch;
+    return PhysicsSystem::chooseSubSteps(components, deltaTime, settings, scratch);
+}
+
+int main() {
+    PhysicsSettings settings;
+    settings.maxSubSteps = 8;
+
+    CHECK(subSteps(0.0f, settings) == 1);
+    CHECK(subSteps(60.0f, settings) == 2);
+    CHECK(subSteps(1e30f, settings) == 8);
+    CHECK(subSteps(std::numeric_limits<float>::infinity(), settings) == 8);
+    // A NaN velocity loses every max() and is skipped; inf * 0 makes the ratio itself NaN
+    int nanSteps = subSteps(std::numeric_limits<float>::quiet_NaN(), settings);
+    CHECK(nanSteps >= 1 && nanSteps <= 8);
+    CHECK(subSteps(std::numeric_limits<float>::infinity(), settings, 0.0f) == 8);
+
+    // The per-entity budget lowers the ceiling
+    settings.maxEntitySubSteps = 12;
+    CHECK(subSteps(1e30f, settings) == 3);
+    return testResult();
+}
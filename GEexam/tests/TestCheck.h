@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdio>
+
+// Assertions for the ctest executables. A failed CHECK prints where and keeps going;
+// main returns testResult() so the failure reaches ctest.
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++testFailures();                                                               \
+        }                                                                                   \
+    } while (0)
+
+inline int testResult() {
+    if (testFailures() > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", testFailures());
+        return 1;
+    }
+    return 0;
+}
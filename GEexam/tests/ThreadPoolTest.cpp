@@ -0,0 +1,49 @@
+// ThreadPool::parallelFor from several threads at once: every call runs each of its
+// indices exactly once and returns only after all of them finished.
+#include "TestCheck.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+const size_t CALLERS = 4;
+const size_t CALLS = 500;
+const size_t JOBS = 64;
+
+int main() {
+    // Fixed worker count, the sandbox may report a single hardware thread
+    ThreadPool pool(3);
+    CHECK(pool.getWorkerCount() == 3);
+
+    std::vector<size_t> badCalls(CALLERS, 0);
+    std::vector<std::thread> callers;
+    for (size_t c = 0; c < CALLERS; ++c) {
+        callers.emplace_back([&pool, &badCalls, c] {
+            std::vector<std::atomic<int>> hits(JOBS);
+            for (size_t call = 0; call < CALLS; ++call) {
+                for (std::atomic<int>& hit : hits) hit = 0;
+                // Vary the count so calls of different sizes overlap
+                size_t count = JOBS - (call + c) % 8;
+                pool.parallelFor(count, [&hits](size_t index) { hits[index]++; });
+
+                for (size_t i = 0; i < JOBS; ++i) {
+                    if (hits[i] != (i < count ? 1 : 0)) {
+                        badCalls[c]++;
+                        break;
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread& caller : callers) caller.join();
+
+    for (size_t c = 0; c < CALLERS; ++c) {
+        CHECK(badCalls[c] == 0);
+    }
+
+    // An empty loop never calls the job
+    size_t calls = 0;
+    pool.parallelFor(0, [&calls](size_t) { calls++; });
+    CHECK(calls == 0);
+    return testResult();
+}